@@ -0,0 +1,121 @@
+#include "mandel_benchmark.h"
+#include "mandel_bigfixed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+// nanoseconds per call of op over the given number of calls
+template<typename Op>
+static double timeOperation(Op op, int calls)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(int i = 0; i < calls; i++){
+		op();
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end-start).count()/calls;
+}
+
+void benchmarkBigFixed()
+{
+	const int limbs[] = {2, 4, 8, 16};
+	const int calls = 2000000;
+	printf("MandelBigFixed, %d calls each:\n", calls);
+	printf("limbs   mul (ns)   sqr (ns)\n");
+	for(int i = 0; i < 4; i++){
+		// 1/3 and 1/7 have all limbs set, zero limbs would be skipped
+		MandelBigFixed a(1.0, limbs[i]);
+		MandelBigFixed b(1.0, limbs[i]);
+		MandelBigFixed r;
+		MandelBigFixed::divSmall(a, 3);
+		MandelBigFixed::divSmall(b, 7);
+		double mul_ns = timeOperation([&](){MandelBigFixed::mul(a, b, r);}, calls);
+		double sqr_ns = timeOperation([&](){MandelBigFixed::sqr(a, r);}, calls);
+		printf("%5d %10.1f %10.1f\n", limbs[i], mul_ns, sqr_ns);
+	}
+}
+
+void benchmarkCPUStrategies(MandelCPU & cpu, int w, int h, MandelTileScheduler * scheduler)
+{
+	const int runs = 5;
+	MandelCPUStrategy old_strategy = cpu.getStrategy();
+	// filling strategies are not used with multisampling
+	cpu.setNumSamples(1);
+	std::vector<uint32_t> reference(w*h);
+	std::vector<uint32_t> image(w*h);
+	printf("CPU strategies at %dx%d, best of %d runs:\n", w, h, runs);
+	printf("strategy           time (ms)   iterated   differing pixels\n");
+	for(int s = 0; s < NUM_MANDEL_CPU_STRATEGIES; s++){
+		MandelCPUStrategy strategy = static_cast<MandelCPUStrategy>(s);
+		cpu.setStrategy(strategy);
+		// brute force comes first and is the reference image
+		uint32_t * target = strategy == MANDEL_CPU_BRUTE_FORCE ? &reference[0] : &image[0];
+		double best_ms = 0;
+		for(int r = 0; r < runs; r++){
+			cpu.resetStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			cpu.render(target, scheduler);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end-start).count();
+			if(r == 0 || ms < best_ms)
+				best_ms = ms;
+		}
+		int differing = 0;
+		if(strategy != MANDEL_CPU_BRUTE_FORCE){
+			for(int i = 0; i < w*h; i++){
+				differing += image[i] != reference[i];
+			}
+		}
+		printf("%-18s %9.1f %9.1f%% %18d\n", getMandelCPUStrategyName(strategy), best_ms,
+			cpu.getStats().getIteratedFraction()*100.0, differing);
+	}
+	cpu.setStrategy(old_strategy);
+	cpu.resetStats();
+}
+
+void benchmarkAdaptiveSampling(MandelCPU & cpu, int w, int h, int num_samples, MandelTileScheduler * scheduler)
+{
+	const int runs = 5;
+	bool old_adaptive = cpu.getAdaptiveSampling();
+	MandelCPUStrategy old_strategy = cpu.getStrategy();
+	cpu.setStrategy(MANDEL_CPU_BRUTE_FORCE);
+	cpu.setNumSamples(num_samples);
+	std::vector<uint32_t> reference(w*h);
+	std::vector<uint32_t> image(w*h);
+	printf("Adaptive sampling at %dx%d with %d samples, best of %d runs:\n", w, h, num_samples, runs);
+	printf("sampling   time (ms)   multisampled   differing pixels   max. difference\n");
+	for(int adaptive = 0; adaptive < 2; adaptive++){
+		cpu.setAdaptiveSampling(adaptive != 0);
+		// every pixel multisampled comes first and is the reference image
+		uint32_t * target = adaptive ? &image[0] : &reference[0];
+		double best_ms = 0;
+		for(int r = 0; r < runs; r++){
+			cpu.resetStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			cpu.render(target, scheduler);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end-start).count();
+			if(r == 0 || ms < best_ms)
+				best_ms = ms;
+		}
+		int differing = 0;
+		int max_difference = 0;
+		if(adaptive){
+			for(int i = 0; i < w*h; i++){
+				differing += image[i] != reference[i];
+				for(int c = 0; c < 3; c++){
+					int d = abs(static_cast<int>((image[i]>>(c*8))&0xFF) - static_cast<int>((reference[i]>>(c*8))&0xFF));
+					if(d > max_difference)
+						max_difference = d;
+				}
+			}
+		}
+		double multisampled = adaptive ? cpu.getStats().supersampledPoints/static_cast<double>(w*h) : 1.0;
+		printf("%-10s %9.1f %13.1f%% %18d %17d\n", adaptive ? "adaptive" : "full", best_ms,
+			multisampled*100.0, differing, max_difference);
+	}
+	cpu.setAdaptiveSampling(old_adaptive);
+	cpu.setStrategy(old_strategy);
+	cpu.resetStats();
+}
@@ -0,0 +1,19 @@
+#ifndef MANDEL_BENCHMARK_H
+#define MANDEL_BENCHMARK_H
+
+#include "mandel_cpu.h"
+
+// benchmarks selected with --benchmark <name>, results are printed to stdout
+
+// MandelBigFixed::mul and MandelBigFixed::sqr at 2, 4, 8 and 16 limbs
+void benchmarkBigFixed();
+
+// renders the current view of cpu (window size w x h) with every MandelCPUStrategy,
+// prints time, fraction of iterated pixels and pixels that differ from brute force
+void benchmarkCPUStrategies(MandelCPU & cpu, int w, int h, MandelTileScheduler * scheduler);
+
+// renders the current view of cpu with num_samples samples per pixel, once for every pixel and once with
+// adaptive sampling, prints time, fraction of multisampled pixels and the difference of the images
+void benchmarkAdaptiveSampling(MandelCPU & cpu, int w, int h, int num_samples, MandelTileScheduler * scheduler);
+
+#endif
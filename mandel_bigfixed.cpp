@@ -0,0 +1,332 @@
+#include "mandel_bigfixed.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+void MandelBigFixed::setZero(int limbs)
+{
+	if(limbs < 2) limbs = 2;
+	if(limbs > MANDEL_BIGFIXED_MAX_LIMBS) limbs = MANDEL_BIGFIXED_MAX_LIMBS;
+	_limbs = limbs;
+	_negative = false;
+	memset(_d, 0, sizeof(_d));
+}
+
+void MandelBigFixed::set(double d, int limbs)
+{
+	setZero(limbs);
+	_negative = d < 0;
+	double x = fabs(d);
+	// multiplying by 2^32 is exact, so every bit of the double ends up in the limbs
+	for(int i = _limbs-1; i >= 0; i--){
+		double limb = floor(x);
+		_d[i] = static_cast<uint32_t>(limb);
+		x = (x-limb)*4294967296.0;
+	}
+}
+
+void MandelBigFixed::setLimbs(int limbs)
+{
+	if(limbs < 2) limbs = 2;
+	if(limbs > MANDEL_BIGFIXED_MAX_LIMBS) limbs = MANDEL_BIGFIXED_MAX_LIMBS;
+	if(limbs > _limbs){
+		int shift = limbs-_limbs;
+		memmove(_d+shift, _d, _limbs*sizeof(uint32_t));
+		memset(_d, 0, shift*sizeof(uint32_t));
+	}
+	else if(limbs < _limbs){
+		int shift = _limbs-limbs;
+		memmove(_d, _d+shift, limbs*sizeof(uint32_t));
+		memset(_d+limbs, 0, shift*sizeof(uint32_t));
+	}
+	_limbs = limbs;
+}
+
+double MandelBigFixed::toDouble() const
+{
+	double r = 0;
+	for(int i = 0; i < _limbs; i++){
+		r += ldexp(static_cast<double>(_d[i]), 32*(i-(_limbs-1)));
+	}
+	return _negative ? -r : r;
+}
+
+int MandelBigFixed::compareMagnitude(const uint32_t * a, const uint32_t * b, int n)
+{
+	for(int i = n-1; i >= 0; i--){
+		if(a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+void MandelBigFixed::addMagnitude(const uint32_t * a, const uint32_t * b, uint32_t * r, int n)
+{
+	uint64_t carry = 0;
+	for(int i = 0; i < n; i++){
+		uint64_t t = static_cast<uint64_t>(a[i]) + b[i] + carry;
+		r[i] = static_cast<uint32_t>(t);
+		carry = t>>32;
+	}
+}
+
+void MandelBigFixed::subMagnitude(const uint32_t * a, const uint32_t * b, uint32_t * r, int n)
+{
+	uint64_t borrow = 0;
+	for(int i = 0; i < n; i++){
+		uint64_t t = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+		r[i] = static_cast<uint32_t>(t);
+		borrow = (t>>32) ? 1 : 0;
+	}
+}
+
+void MandelBigFixed::addSigned(const MandelBigFixed & a, const MandelBigFixed & b_in, bool negate_b, MandelBigFixed & r)
+{
+	const MandelBigFixed * b = &b_in;
+	MandelBigFixed b_resized;
+	int n = a._limbs;
+	if(b->_limbs != n){
+		b_resized = b_in;
+		b_resized.setLimbs(n);
+		b = &b_resized;
+	}
+	bool b_negative = negate_b ? !b->_negative : b->_negative;
+	if(a._negative == b_negative){
+		addMagnitude(a._d, b->_d, r._d, n);
+		r._negative = a._negative;
+	}
+	else if(compareMagnitude(a._d, b->_d, n) >= 0){
+		subMagnitude(a._d, b->_d, r._d, n);
+		r._negative = a._negative;
+	}
+	else{
+		subMagnitude(b->_d, a._d, r._d, n);
+		r._negative = b_negative;
+	}
+	if(r._limbs > n){
+		memset(r._d+n, 0, (r._limbs-n)*sizeof(uint32_t));
+	}
+	r._limbs = n;
+}
+
+void MandelBigFixed::add(const MandelBigFixed & a, const MandelBigFixed & b, MandelBigFixed & r)
+{
+	addSigned(a, b, false, r);
+}
+
+void MandelBigFixed::sub(const MandelBigFixed & a, const MandelBigFixed & b, MandelBigFixed & r)
+{
+	addSigned(a, b, true, r);
+}
+
+void MandelBigFixed::mul(const MandelBigFixed & a, const MandelBigFixed & b_in, MandelBigFixed & r)
+{
+	const MandelBigFixed * b = &b_in;
+	MandelBigFixed b_resized;
+	int n = a._limbs;
+	if(b->_limbs != n){
+		b_resized = b_in;
+		b_resized.setLimbs(n);
+		b = &b_resized;
+	}
+	// Product of the integers made up by the limbs has 2n limbs, the result are limbs n-1..2n-2.
+	// Columns below n-2 are skipped (short product), error stays within a few units of the last limb.
+	uint32_t acc[2*MANDEL_BIGFIXED_MAX_LIMBS];
+	memset(acc, 0, sizeof(uint32_t)*2*n);
+	int lowest = n-2;
+	for(int i = 0; i < n; i++){
+		uint64_t carry = 0;
+		uint64_t ai = a._d[i];
+		if(ai == 0)
+			continue;
+		int j = lowest-i;
+		if(j < 0) j = 0;
+		for(; j < n; j++){
+			uint64_t t = ai*b->_d[j] + acc[i+j] + carry;
+			acc[i+j] = static_cast<uint32_t>(t);
+			carry = t>>32;
+		}
+		acc[i+n] = static_cast<uint32_t>(carry);
+	}
+	r._negative = a._negative != b->_negative;
+	memcpy(r._d, acc+n-1, n*sizeof(uint32_t));
+	if(r._limbs > n){
+		memset(r._d+n, 0, (r._limbs-n)*sizeof(uint32_t));
+	}
+	r._limbs = n;
+}
+
+void MandelBigFixed::sqr(const MandelBigFixed & a, MandelBigFixed & r)
+{
+	// same columns as mul(a, a, r), but every product a_i*a_j (i != j) is computed once and doubled
+	int n = a._limbs;
+	uint32_t acc[2*MANDEL_BIGFIXED_MAX_LIMBS];
+	memset(acc, 0, sizeof(uint32_t)*2*n);
+	int lowest = n-2;
+	for(int i = 0; i < n; i++){
+		uint64_t carry = 0;
+		uint64_t ai = a._d[i];
+		int j = lowest-i;
+		if(j < i+1) j = i+1;
+		if(ai == 0 || j >= n)
+			continue;
+		for(; j < n; j++){
+			uint64_t t = ai*a._d[j] + acc[i+j] + carry;
+			acc[i+j] = static_cast<uint32_t>(t);
+			carry = t>>32;
+		}
+		acc[i+n] = static_cast<uint32_t>(carry);
+	}
+	uint32_t top = 0;
+	for(int i = 0; i < 2*n; i++){
+		uint32_t v = acc[i];
+		acc[i] = (v<<1) | top;
+		top = v>>31;
+	}
+	uint64_t carry = 0;
+	for(int i = 0; i < n; i++){
+		if(2*i < lowest)
+			continue;
+		uint64_t sq = static_cast<uint64_t>(a._d[i])*a._d[i];
+		uint64_t t = static_cast<uint64_t>(acc[2*i]) + static_cast<uint32_t>(sq) + carry;
+		acc[2*i] = static_cast<uint32_t>(t);
+		t = static_cast<uint64_t>(acc[2*i+1]) + (sq>>32) + (t>>32);
+		acc[2*i+1] = static_cast<uint32_t>(t);
+		carry = t>>32;
+	}
+	r._negative = false;
+	memcpy(r._d, acc+n-1, n*sizeof(uint32_t));
+	if(r._limbs > n){
+		memset(r._d+n, 0, (r._limbs-n)*sizeof(uint32_t));
+	}
+	r._limbs = n;
+}
+
+void MandelBigFixed::twice(const MandelBigFixed & a, MandelBigFixed & r)
+{
+	int n = a._limbs;
+	uint32_t carry = 0;
+	for(int i = 0; i < n; i++){
+		uint32_t v = a._d[i];
+		r._d[i] = (v<<1) | carry;
+		carry = v>>31;
+	}
+	r._negative = a._negative;
+	if(r._limbs > n){
+		memset(r._d+n, 0, (r._limbs-n)*sizeof(uint32_t));
+	}
+	r._limbs = n;
+}
+
+void MandelBigFixed::mulSmall(MandelBigFixed & a, uint32_t m)
+{
+	uint64_t carry = 0;
+	for(int i = 0; i < a._limbs; i++){
+		uint64_t t = static_cast<uint64_t>(a._d[i])*m + carry;
+		a._d[i] = static_cast<uint32_t>(t);
+		carry = t>>32;
+	}
+}
+
+void MandelBigFixed::divSmall(MandelBigFixed & a, uint32_t m)
+{
+	uint64_t rest = 0;
+	for(int i = a._limbs-1; i >= 0; i--){
+		uint64_t t = (rest<<32) | a._d[i];
+		a._d[i] = static_cast<uint32_t>(t/m);
+		rest = t%m;
+	}
+}
+
+bool MandelBigFixed::parse(const char * str, const char ** end)
+{
+	const char * c = str;
+	while(isspace(*c)) c++;
+	bool negative = false;
+	if(*c == '-' || *c == '+'){
+		negative = *c == '-';
+		c++;
+	}
+	const char * int_start = c;
+	while(isdigit(*c)) c++;
+	const char * int_end = c;
+	const char * frac_start = c;
+	const char * frac_end = c;
+	if(*c == '.'){
+		frac_start = ++c;
+		while(isdigit(*c)) c++;
+		frac_end = c;
+	}
+	if(int_start == int_end && frac_start == frac_end){
+		return false;
+	}
+	int exponent = 0;
+	if(*c == 'e' || *c == 'E'){
+		char * exp_end;
+		long e = strtol(c+1, &exp_end, 10);
+		// more digits than the fraction of the largest number can hold
+		long max_exponent = static_cast<long>((MANDEL_BIGFIXED_MAX_LIMBS-1)*32*log10(2.0));
+		if(e > max_exponent || e < -max_exponent)
+			return false;
+		exponent = static_cast<int>(e);
+		if(exp_end != c+1)
+			c = exp_end;
+	}
+	if(end) *end = c;
+
+	// digits moved behind the point by a negative exponent need limbs as well
+	int frac_digits = static_cast<int>(frac_end-frac_start) + (exponent < 0 ? -exponent : 0);
+	setZero(2 + static_cast<int>(ceil(frac_digits*log2(10.0)/32)));
+	// fraction from the last digit to the first: f = (digit + f)/10
+	for(const char * d = frac_end-1; d >= frac_start; d--){
+		_d[_limbs-1] += *d-'0';
+		divSmall(*this, 10);
+	}
+	uint64_t integer = 0;
+	for(const char * d = int_start; d < int_end; d++){
+		integer = integer*10 + (*d-'0');
+		if(integer > 0xFFFFFFFF)
+			return false;
+	}
+	_d[_limbs-1] = static_cast<uint32_t>(integer);
+	for(; exponent > 0; exponent--){
+		if(_d[_limbs-1] >= 0xFFFFFFFF/10)
+			return false;
+		mulSmall(*this, 10);
+	}
+	for(; exponent < 0; exponent++){
+		divSmall(*this, 10);
+	}
+	_negative = negative;
+	return true;
+}
+
+void MandelBigFixed::toString(char * buffer, int size) const
+{
+	if(size <= 0)
+		return;
+	// every fractional limb resolves 32*log10(2) digits
+	int digits = static_cast<int>(ceil((_limbs-1)*32*log10(2.0))) + 1;
+	int len = snprintf(buffer, size, "%s%u.", _negative ? "-" : "", _d[_limbs-1]);
+	MandelBigFixed f = *this;
+	f._d[_limbs-1] = 0;
+	for(int i = 0; i < digits && len < size-1; i++){
+		mulSmall(f, 10);
+		buffer[len++] = '0' + f._d[_limbs-1];
+		f._d[_limbs-1] = 0;
+	}
+	buffer[len < size ? len : size-1] = '\0';
+}
+
+int MandelBigFixed::getLimbsForResolution(double spacing)
+{
+	// one integer limb, fractional bits for the spacing and 64 guard bits
+	double bits = spacing > 0 ? -log2(spacing) : 0;
+	if(bits < 0) bits = 0;
+	int limbs = 1 + static_cast<int>(ceil((bits+64)/32));
+	if(limbs < 2) limbs = 2;
+	if(limbs > MANDEL_BIGFIXED_MAX_LIMBS) limbs = MANDEL_BIGFIXED_MAX_LIMBS;
+	return limbs;
+}
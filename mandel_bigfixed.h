@@ -0,0 +1,57 @@
+#ifndef MANDEL_BIGFIXED_H
+#define MANDEL_BIGFIXED_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// maximum number of 32 bit limbs, 64 limbs give 2016 fractional bits (about 1e-600)
+#define MANDEL_BIGFIXED_MAX_LIMBS 64
+
+// Multi-limb fixed-point number (sign and magnitude) used where doubles run out of precision.
+// The most significant limb holds the integer part, all other limbs are fractional,
+// so values have to stay below 2^32 in magnitude.
+// Limbs are stored least significant first. Results take the limb count of the first operand.
+class MandelBigFixed{
+public:
+	MandelBigFixed(){setZero(2);}
+	explicit MandelBigFixed(double d, int limbs = 2){set(d, limbs);}
+
+	void setZero(int limbs);
+	void set(double d, int limbs);
+	// change the number of limbs, keeping the value (truncated if limbs are removed)
+	void setLimbs(int limbs);
+	int getLimbs() const {return _limbs;}
+	bool isNegative() const {return _negative;}
+	double toDouble() const;
+	// reads a decimal number (optional sign, fraction and exponent), the number of limbs is chosen
+	// so all given digits are kept, end is set to the first character after the number. Returns false
+	// for exponents beyond the digits MANDEL_BIGFIXED_MAX_LIMBS can hold (about 600)
+	bool parse(const char * str, const char ** end = NULL);
+	// writes the value as decimal number with all digits resolved by the limbs
+	void toString(char * buffer, int size) const;
+
+	// r = a + b, r = a - b, r = a*b, r = a*a (r may be the same object as a or b)
+	static void add(const MandelBigFixed & a, const MandelBigFixed & b, MandelBigFixed & r);
+	static void sub(const MandelBigFixed & a, const MandelBigFixed & b, MandelBigFixed & r);
+	static void mul(const MandelBigFixed & a, const MandelBigFixed & b, MandelBigFixed & r);
+	static void sqr(const MandelBigFixed & a, MandelBigFixed & r);
+	// r = 2*a
+	static void twice(const MandelBigFixed & a, MandelBigFixed & r);
+	// a = a*m, a = a/m for small integers m
+	static void mulSmall(MandelBigFixed & a, uint32_t m);
+	static void divSmall(MandelBigFixed & a, uint32_t m);
+
+	// limbs needed for coordinates on a grid of the given spacing (e.g. pixel size)
+	static int getLimbsForResolution(double spacing);
+private:
+	// magnitude compare/add/sub on the first n limbs
+	static int compareMagnitude(const uint32_t * a, const uint32_t * b, int n);
+	static void addMagnitude(const uint32_t * a, const uint32_t * b, uint32_t * r, int n);
+	static void subMagnitude(const uint32_t * a, const uint32_t * b, uint32_t * r, int n);// requires |a| >= |b|
+	static void addSigned(const MandelBigFixed & a, const MandelBigFixed & b, bool negate_b, MandelBigFixed & r);
+	bool _negative;
+	int _limbs;
+	uint32_t _d[MANDEL_BIGFIXED_MAX_LIMBS];
+};
+
+#endif
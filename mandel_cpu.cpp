@@ -0,0 +1,927 @@
+#include "mandel_cpu.h"
+#include "mandel_sobol.h"
+#include <math.h>
+#include <algorithm>
+#include <string.h>
+
+static const char * MANDEL_CPU_STRATEGY_NAMES[NUM_MANDEL_CPU_STRATEGIES] = {
+	"brute_force",
+	"mariani_silver",
+	"boundary_tracing"
+};
+
+const char * getMandelCPUStrategyName(MandelCPUStrategy strategy)
+{
+	if(strategy < 0 || strategy >= NUM_MANDEL_CPU_STRATEGIES)
+		return "unknown";
+	return MANDEL_CPU_STRATEGY_NAMES[strategy];
+}
+
+MandelCPUStrategy getMandelCPUStrategy(const char * name)
+{
+	for(int s = 0; s < NUM_MANDEL_CPU_STRATEGIES; s++){
+		if(!strcmp(name, MANDEL_CPU_STRATEGY_NAMES[s])){
+			return static_cast<MandelCPUStrategy>(s);
+		}
+	}
+	return NUM_MANDEL_CPU_STRATEGIES;
+}
+
+MandelCPU::MandelCPU()
+{
+	_windowW = 800;
+	_windowH = 600;
+	for(int i = 0; i < 9; i++)
+		_transform[i] = (i%4 == 0) ? 1.0 : 0.0;
+	_maxIterations = 128;
+	_juliaC[0] = 0; _juliaC[1] = 0;
+	_julia = false;
+	_doublePrecision = false;
+	setKernel(MANDEL_KERNEL_AUTO);
+	_laneRefill = true;
+	_interiorCheck = true;
+	_periodicityTolerance = 0;
+	_strategy = MANDEL_CPU_BRUTE_FORCE;
+	_perturbation = false;
+	_maxReferences = 64;
+	_seriesApproximation = false;
+	_seriesTolerance = MANDEL_CPU_SERIES_TOLERANCE;
+	setNumSamples(1);
+	_adaptiveSampling = false;
+	_renderTarget = NULL;
+	_renderY = 0;
+	_escapeTarget = NULL;
+	_cacheLevel = 0;
+	_cacheOrigin[0] = 0;
+	_cacheOrigin[1] = 0;
+	_cacheTilesX = 0;
+	_cacheTilesY = 0;
+	uint32_t default_colors[2] = {0xFF000000, 0xFFFFFFFF};
+	setColorMap(default_colors, 2, false);
+	_colorOffset = 0;
+}
+
+void MandelCPU::setTransform(const double * mat3)
+{
+	for(int i = 0; i < 9; i++)
+		_transform[i] = mat3[i];
+	// every bit of the double, perturbation deltas are relative to the exact center of the transform
+	_center[0].set(mat3[6], MANDEL_BIGFIXED_MAX_LIMBS);
+	_center[1].set(mat3[7], MANDEL_BIGFIXED_MAX_LIMBS);
+}
+
+void MandelCPU::setCenter(const MandelBigFixed & x, const MandelBigFixed & y)
+{
+	_center[0] = x;
+	_center[1] = y;
+}
+
+void MandelCPU::setNumSamples(unsigned int n)
+{
+	// same selection as MandelShader::setNumSamples
+	int sobol_index = 0;
+	n = n>>1;
+	while(n != 0){
+		n = n>>1;
+		sobol_index++;
+	}
+	if(sobol_index > NUM_SOBOL_MAPS-1){
+		sobol_index = NUM_SOBOL_MAPS-1;
+	}
+	_numSamples = 1<<sobol_index;
+	_sampleMap = SOBOL_MAPS[sobol_index];
+}
+
+void MandelCPU::setColorMap(const uint32_t * colors, int num_colors, bool nearest)
+{
+	_numColors = num_colors;
+	_nearest = nearest;
+	_colorMap.resize(num_colors*3);
+	for(int i = 0; i < num_colors; i++){
+		// color map texture is uploaded as GL_RGBA/GL_UNSIGNED_BYTE, so red is the lowest byte
+		_colorMap[i*3 + 0] = ((colors[i]>>0)&0xFF)/255.f;
+		_colorMap[i*3 + 1] = ((colors[i]>>8)&0xFF)/255.f;
+		_colorMap[i*3 + 2] = ((colors[i]>>16)&0xFF)/255.f;
+	}
+}
+
+void MandelCPU::sampleColorMap(float s, float * rgb)
+{
+	// emulating texture1D() with GL_CLAMP_TO_EDGE
+	if(_nearest){
+		int i = static_cast<int>(floorf(s*_numColors));
+		if(i < 0) i = 0;
+		if(i > _numColors-1) i = _numColors-1;
+		rgb[0] = _colorMap[i*3 + 0];
+		rgb[1] = _colorMap[i*3 + 1];
+		rgb[2] = _colorMap[i*3 + 2];
+	}
+	else{
+		float u = s*_numColors - 0.5f;
+		float u_floor = floorf(u);
+		float t = u - u_floor;
+		int i0 = static_cast<int>(u_floor);
+		int i1 = i0+1;
+		if(i0 < 0) i0 = 0;
+		if(i0 > _numColors-1) i0 = _numColors-1;
+		if(i1 < 0) i1 = 0;
+		if(i1 > _numColors-1) i1 = _numColors-1;
+		for(int c = 0; c < 3; c++){
+			rgb[c] = _colorMap[i0*3 + c]*(1-t) + _colorMap[i1*3 + c]*t;
+		}
+	}
+}
+
+void MandelCPU::pixelToWorld(double x, double y, double * world)
+{
+	double p[2];
+	p[0] = 2*x/_windowW - 1;
+	p[1] = 2*y/_windowH - 1;
+	// transform is column major (as passed to glUniformMatrix3dv)
+	world[0] = _transform[0]*p[0] + _transform[3]*p[1] + _transform[6];
+	world[1] = _transform[1]*p[0] + _transform[4]*p[1] + _transform[7];
+}
+
+void MandelCPU::render(uint32_t * rgba, MandelTileScheduler * scheduler)
+{
+	if(_perturbation || _seriesApproximation){
+		renderPerturbation(rgba, scheduler);
+		return;
+	}
+	renderRows(0, _windowH, rgba, scheduler);
+}
+
+void MandelCPU::renderRows(int y, int h, uint32_t * rgba, MandelTileScheduler * scheduler)
+{
+	if(scheduler == NULL){
+		renderRect(0, y, _windowW, h, rgba, _windowW, &_stats);
+		return;
+	}
+	_renderTarget = rgba;
+	_renderY = y;
+	_workerStats.assign(scheduler->getNumThreads(), MandelKernelStats());
+	scheduler->run(_windowW, h, MANDEL_CPU_TILE_SIZE, renderTile, this);
+	for(size_t i = 0; i < _workerStats.size(); i++){
+		_stats.add(_workerStats[i]);
+	}
+}
+
+double MandelCPU::getPixelSize()
+{
+	double spacing_x = 2*fabs(_transform[0])/_windowW;
+	double spacing_y = 2*fabs(_transform[4])/_windowH;
+	return spacing_x < spacing_y ? spacing_x : spacing_y;
+}
+
+void MandelCPU::renderTile(const MandelTile & tile, int worker, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	uint32_t * target = cpu->_renderTarget + tile.y*cpu->_windowW + tile.x;
+	cpu->renderRect(tile.x, cpu->_renderY + tile.y, tile.w, tile.h, target, cpu->_windowW, &cpu->_workerStats[worker]);
+}
+
+void MandelCPU::getKernelParams(MandelKernelParams & params)
+{
+	params.maxIterations = _maxIterations;
+	params.julia = _julia;
+	params.juliaC[0] = _juliaC[0];
+	params.juliaC[1] = _juliaC[1];
+	params.laneRefill = _laneRefill;
+	params.interiorCheck = _interiorCheck;
+	params.periodicityTolerance = _periodicityTolerance*getPixelSize();
+}
+
+void MandelCPU::renderRect(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats)
+{
+	// filled pixels cannot be supersampled
+	if(_strategy != MANDEL_CPU_BRUTE_FORCE && _numSamples == 1){
+		renderRectFilled(x, y, w, h, rgba, stride, stats);
+		return;
+	}
+	if(_adaptiveSampling && _numSamples > 1){
+		renderRectAdaptive(x, y, w, h, rgba, stride, stats);
+		return;
+	}
+	MandelKernel kernel = getMandelKernel(_kernelType, _doublePrecision);
+	MandelKernelParams params;
+	getKernelParams(params);
+
+	// one row of samples is passed to the kernel at once
+	std::vector<double> px(w);
+	std::vector<double> py(w);
+	std::vector<int> iterations(w);
+	std::vector<float> color(w*3);
+	for(int row = y; row < y+h; row++){
+		std::fill(color.begin(), color.end(), 0.f);
+		for(int sample_i = 0; sample_i < _numSamples; sample_i++){
+			for(int col = x; col < x+w; col++){
+				double p[2];
+				// gl_FragCoord is at the pixel center
+				pixelToWorld(col + 0.5 + _sampleMap[sample_i*2 + 0], row + 0.5 + _sampleMap[sample_i*2 + 1], p);
+				px[col-x] = p[0];
+				py[col-x] = p[1];
+			}
+			kernel(params, &px[0], &py[0], w, &iterations[0], stats);
+			if(stats){
+				stats->iteratedPoints += w;
+			}
+			for(int i = 0; i < w; i++){
+				addColor(iterations[i], &color[i*3]);
+			}
+		}
+		uint32_t * out = rgba + (row-y)*stride;
+		for(int i = 0; i < w; i++){
+			out[i] = packColor(&color[i*3]);
+		}
+	}
+}
+
+void MandelCPU::renderPoints(const double * x, const double * y, int n, uint32_t * rgba, MandelKernelStats * stats)
+{
+	MandelKernel kernel = getMandelKernel(_kernelType, _doublePrecision);
+	MandelKernelParams params;
+	getKernelParams(params);
+	std::vector<int> iterations(n);
+	kernel(params, x, y, n, &iterations[0], stats);
+	if(stats){
+		stats->iteratedPoints += n;
+	}
+	for(int i = 0; i < n; i++){
+		float color[3] = {0, 0, 0};
+		addColor(iterations[i], color);
+		// packColor averages over _numSamples
+		for(int c = 0; c < 3; c++)
+			color[c] *= _numSamples;
+		rgba[i] = packColor(color);
+	}
+}
+
+void MandelCPU::renderEscapeData(MandelEscapePixel * pixels, MandelTileScheduler * scheduler)
+{
+	_escapeTarget = pixels;
+	if(scheduler == NULL){
+		MandelTile t = {0, 0, _windowW, _windowH};
+		_workerStats.assign(1, MandelKernelStats());
+		escapeDataTile(t, 0, this);
+	}
+	else{
+		_workerStats.assign(scheduler->getNumThreads(), MandelKernelStats());
+		scheduler->run(_windowW, _windowH, MANDEL_CPU_TILE_SIZE, escapeDataTile, this);
+	}
+	for(size_t i = 0; i < _workerStats.size(); i++){
+		_stats.add(_workerStats[i]);
+	}
+}
+
+void MandelCPU::escapeDataTile(const MandelTile & tile, int worker, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	MandelKernelParams params;
+	cpu->getKernelParams(params);
+	std::vector<double> px(tile.w);
+	std::vector<double> py(tile.w);
+	std::vector<int> iterations(tile.w);
+	std::vector<double> norms(tile.w);
+	for(int row = tile.y; row < tile.y+tile.h; row++){
+		for(int col = tile.x; col < tile.x+tile.w; col++){
+			double p[2];
+			cpu->pixelToWorld(col + 0.5, row + 0.5, p);
+			px[col-tile.x] = p[0];
+			py[col-tile.x] = p[1];
+		}
+		mandelKernelEscapeData(params, &px[0], &py[0], tile.w, &iterations[0], &norms[0], &cpu->_workerStats[worker]);
+		cpu->_workerStats[worker].iteratedPoints += tile.w;
+		MandelEscapePixel * out = cpu->_escapeTarget + static_cast<size_t>(row)*cpu->_windowW + tile.x;
+		for(int i = 0; i < tile.w; i++){
+			out[i].norm = static_cast<float>(norms[i]);
+			if(iterations[i] >= params.maxIterations){
+				out[i].iterations = static_cast<float>(params.maxIterations);
+				out[i].flags = MANDEL_ESCAPE_INTERIOR;
+			}
+			else{
+				// continuous count, |z| > 2 at escape
+				out[i].iterations = static_cast<float>(iterations[i] + 1 - log2(0.5*log(norms[i])));
+				out[i].flags = 0;
+			}
+		}
+	}
+}
+
+void MandelCPU::colorEscapeData(const MandelEscapePixel * pixels, int n, uint32_t * rgba)
+{
+	for(int i = 0; i < n; i++){
+		// as addColor with the continuous count
+		float s = 1;
+		if(!(pixels[i].flags & MANDEL_ESCAPE_INTERIOR) && _maxIterations > 1){
+			s = pixels[i].iterations/(_maxIterations-1) + _colorOffset;
+			if(s > 1)
+				s -= 1;
+		}
+		float color[3];
+		sampleColorMap(s, color);
+		// packColor averages over _numSamples
+		for(int c = 0; c < 3; c++)
+			color[c] *= _numSamples;
+		rgba[i] = packColor(color);
+	}
+}
+
+void MandelCPU::renderCached(uint32_t * rgba, MandelTileCache & cache, MandelTileScheduler * scheduler)
+{
+	const int n = MANDEL_TILE_CACHE_TILE_SIZE;
+	double level = floor(log2(MANDEL_TILE_CACHE_ROOT_SIZE/n/getPixelSize()) + 0.5);
+	if(level < 0){// tiles of level 0 would cover more than the window
+		render(rgba, scheduler);
+		return;
+	}
+	_cacheLevel = static_cast<int>(level);
+	double tile_size = ldexp(MANDEL_TILE_CACHE_ROOT_SIZE, -_cacheLevel);
+	// tiles overlapping the window
+	double min[2] = {0, 0};
+	double max[2] = {0, 0};
+	for(int corner = 0; corner < 4; corner++){
+		double p[2];
+		pixelToWorld((corner&1) ? _windowW : 0, (corner&2) ? _windowH : 0, p);
+		for(int c = 0; c < 2; c++){
+			if(corner == 0 || p[c] < min[c]) min[c] = p[c];
+			if(corner == 0 || p[c] > max[c]) max[c] = p[c];
+		}
+	}
+	_cacheOrigin[0] = static_cast<int64_t>(floor(min[0]/tile_size));
+	_cacheOrigin[1] = static_cast<int64_t>(floor(min[1]/tile_size));
+	_cacheTilesX = static_cast<int>(static_cast<int64_t>(floor(max[0]/tile_size)) - _cacheOrigin[0] + 1);
+	_cacheTilesY = static_cast<int>(static_cast<int64_t>(floor(max[1]/tile_size)) - _cacheOrigin[1] + 1);
+	_cacheData.resize(static_cast<size_t>(_cacheTilesX)*_cacheTilesY*n*n);
+	_cacheMissing.clear();
+	MandelTileKey key;
+	key.level = _cacheLevel;
+	key.maxIterations = _maxIterations;
+	key.julia = _julia;
+	key.juliaC[0] = _juliaC[0];
+	key.juliaC[1] = _juliaC[1];
+	key.periodicityTolerance = _periodicityTolerance;
+	for(int i = 0; i < _cacheTilesX*_cacheTilesY; i++){
+		key.x = _cacheOrigin[0] + i%_cacheTilesX;
+		key.y = _cacheOrigin[1] + i/_cacheTilesX;
+		if(!cache.load(key, &_cacheData[static_cast<size_t>(i)*n*n]))
+			_cacheMissing.push_back(i);
+	}
+
+	int num_workers = scheduler ? scheduler->getNumThreads() : 1;
+	_workerStats.assign(num_workers, MandelKernelStats());
+	if(!_cacheMissing.empty()){
+		int w = static_cast<int>(_cacheMissing.size())*n;
+		if(scheduler == NULL){
+			MandelTile t = {0, 0, w, n};
+			cacheTile(t, 0, this);
+		}
+		else{
+			scheduler->run(w, n, MANDEL_CPU_TILE_SIZE, cacheTile, this);
+		}
+		for(size_t m = 0; m < _cacheMissing.size(); m++){
+			int i = _cacheMissing[m];
+			key.x = _cacheOrigin[0] + i%_cacheTilesX;
+			key.y = _cacheOrigin[1] + i/_cacheTilesX;
+			cache.store(key, &_cacheData[static_cast<size_t>(i)*n*n]);
+		}
+	}
+	for(size_t i = 0; i < _workerStats.size(); i++){
+		_stats.add(_workerStats[i]);
+	}
+
+	// colors of all iteration counts, looked up per pixel
+	_cacheColors.resize(_maxIterations + 1);
+	for(int i = 0; i <= _maxIterations; i++){
+		float color[3] = {0, 0, 0};
+		addColor(i, color);
+		// packColor averages over _numSamples
+		for(int c = 0; c < 3; c++)
+			color[c] *= _numSamples;
+		_cacheColors[i] = packColor(color);
+	}
+	_renderTarget = rgba;
+	if(scheduler == NULL){
+		MandelTile t = {0, 0, _windowW, _windowH};
+		cachedPixelsTile(t, 0, this);
+	}
+	else{
+		scheduler->run(_windowW, _windowH, MANDEL_CPU_TILE_SIZE, cachedPixelsTile, this);
+	}
+}
+
+void MandelCPU::cacheTile(const MandelTile & tile, int worker, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	const int n = MANDEL_TILE_CACHE_TILE_SIZE;
+	double tile_size = ldexp(MANDEL_TILE_CACHE_ROOT_SIZE, -cpu->_cacheLevel);
+	double spacing = tile_size/n;
+	// cached tiles must not depend on the view, so always double precision and the tolerance in tile samples
+	MandelKernel kernel = getMandelKernel(cpu->_kernelType, true);
+	MandelKernelParams params;
+	cpu->getKernelParams(params);
+	params.periodicityTolerance = cpu->_periodicityTolerance*spacing;
+	std::vector<double> px(tile.w);
+	std::vector<double> py(tile.w);
+	std::vector<int> iterations(tile.w);
+	for(int row = tile.y; row < tile.y+tile.h; row++){
+		for(int col = tile.x; col < tile.x+tile.w; col++){
+			int i = cpu->_cacheMissing[col/n];
+			int64_t tx = cpu->_cacheOrigin[0] + i%cpu->_cacheTilesX;
+			int64_t ty = cpu->_cacheOrigin[1] + i/cpu->_cacheTilesX;
+			px[col-tile.x] = tx*tile_size + (col%n + 0.5)*spacing;
+			py[col-tile.x] = ty*tile_size + (row + 0.5)*spacing;
+		}
+		kernel(params, &px[0], &py[0], tile.w, &iterations[0], &cpu->_workerStats[worker]);
+		cpu->_workerStats[worker].iteratedPoints += tile.w;
+		for(int col = tile.x; col < tile.x+tile.w; col++){
+			size_t index = (static_cast<size_t>(cpu->_cacheMissing[col/n])*n + row)*n + col%n;
+			cpu->_cacheData[index] = iterations[col-tile.x];
+		}
+	}
+}
+
+void MandelCPU::cachedPixelsTile(const MandelTile & tile, int /*worker*/, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	const int n = MANDEL_TILE_CACHE_TILE_SIZE;
+	double inv_spacing = n/ldexp(MANDEL_TILE_CACHE_ROOT_SIZE, -cpu->_cacheLevel);
+	int64_t samples_x = static_cast<int64_t>(cpu->_cacheTilesX)*n;
+	int64_t samples_y = static_cast<int64_t>(cpu->_cacheTilesY)*n;
+	for(int y = tile.y; y < tile.y+tile.h; y++){
+		uint32_t * out = cpu->_renderTarget + static_cast<size_t>(y)*cpu->_windowW;
+		for(int x = tile.x; x < tile.x+tile.w; x++){
+			double p[2];
+			cpu->pixelToWorld(x + 0.5, y + 0.5, p);
+			// sample cell containing the pixel center, relative to the first tile
+			int64_t sx = static_cast<int64_t>(floor(p[0]*inv_spacing)) - cpu->_cacheOrigin[0]*n;
+			int64_t sy = static_cast<int64_t>(floor(p[1]*inv_spacing)) - cpu->_cacheOrigin[1]*n;
+			sx = std::min(std::max(sx, static_cast<int64_t>(0)), samples_x-1);
+			sy = std::min(std::max(sy, static_cast<int64_t>(0)), samples_y-1);
+			size_t t = static_cast<size_t>((sy/n)*cpu->_cacheTilesX + sx/n);
+			int iterations = cpu->_cacheData[(t*n + sy%n)*n + sx%n];
+			out[x] = cpu->_cacheColors[std::min(std::max(iterations, 0), cpu->_maxIterations)];
+		}
+	}
+}
+
+void MandelCPU::renderRectFilled(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats)
+{
+	FillTile t;
+	t.x = x;
+	t.y = y;
+	t.w = w;
+	t.h = h;
+	t.iterations.assign(w*h, -1);
+	t.kernel = getMandelKernel(_kernelType, _doublePrecision);
+	getKernelParams(t.params);
+	t.stats = stats;
+	if(_strategy == MANDEL_CPU_SUBDIVISION)
+		subdivide(t);
+	else
+		traceBoundaries(t);
+	for(int row = 0; row < h; row++){
+		uint32_t * out = rgba + row*stride;
+		for(int col = 0; col < w; col++){
+			float color[3] = {0, 0, 0};
+			addColor(t.iterations[row*w + col], color);
+			out[col] = packColor(color);
+		}
+	}
+}
+
+void MandelCPU::renderRectAdaptive(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats)
+{
+	MandelKernel kernel = getMandelKernel(_kernelType, _doublePrecision);
+	MandelKernelParams params;
+	getKernelParams(params);
+
+	// first pass: one sample per pixel of the rectangle and of a border of one pixel inside the window
+	int x0 = x > 0 ? x-1 : x;
+	int y0 = y > 0 ? y-1 : y;
+	int x1 = x+w < _windowW ? x+w+1 : x+w;
+	int y1 = y+h < _windowH ? y+h+1 : y+h;
+	int first_w = x1-x0;
+	int n = first_w*(y1-y0);
+	std::vector<double> px(n);
+	std::vector<double> py(n);
+	std::vector<int> first(n);
+	for(int row = y0; row < y1; row++){
+		for(int col = x0; col < x1; col++){
+			double p[2];
+			pixelToWorld(col + 0.5 + SOBOL_MAPS[0][0], row + 0.5 + SOBOL_MAPS[0][1], p);
+			px[(row-y0)*first_w + col-x0] = p[0];
+			py[(row-y0)*first_w + col-x0] = p[1];
+		}
+	}
+	kernel(params, &px[0], &py[0], n, &first[0], stats);
+
+	// pixels with a uniform neighbourhood keep the color of their first sample
+	std::vector<int> pixels;
+	for(int row = y; row < y+h; row++){
+		for(int col = x; col < x+w; col++){
+			int it = first[(row-y0)*first_w + col-x0];
+			bool uniform = true;
+			for(int ny = row-1; ny <= row+1 && uniform; ny++){
+				for(int nx = col-1; nx <= col+1; nx++){
+					if(ny >= y0 && ny < y1 && nx >= x0 && nx < x1 && first[(ny-y0)*first_w + nx-x0] != it){
+						uniform = false;
+						break;
+					}
+				}
+			}
+			if(uniform){
+				float color[3] = {0, 0, 0};
+				addColor(it, color);
+				// packColor averages over _numSamples
+				for(int c = 0; c < 3; c++)
+					color[c] *= _numSamples;
+				rgba[(row-y)*stride + col-x] = packColor(color);
+			}
+			else{
+				pixels.push_back((row-y)*w + col-x);
+			}
+		}
+	}
+
+	// all samples of the remaining pixels, one sample of every pixel is passed to the kernel at once
+	int m = static_cast<int>(pixels.size());
+	std::vector<int> iterations(m);
+	std::vector<float> color(m*3, 0.f);
+	for(int sample_i = 0; sample_i < _numSamples && m > 0; sample_i++){
+		for(int i = 0; i < m; i++){
+			double p[2];
+			pixelToWorld(x + pixels[i]%w + 0.5 + _sampleMap[sample_i*2 + 0], y + pixels[i]/w + 0.5 + _sampleMap[sample_i*2 + 1], p);
+			px[i] = p[0];
+			py[i] = p[1];
+		}
+		kernel(params, &px[0], &py[0], m, &iterations[0], stats);
+		for(int i = 0; i < m; i++){
+			addColor(iterations[i], &color[i*3]);
+		}
+	}
+	for(int i = 0; i < m; i++){
+		rgba[(pixels[i]/w)*stride + pixels[i]%w] = packColor(&color[i*3]);
+	}
+	if(stats){
+		stats->iteratedPoints += n + m*_numSamples;
+		stats->supersampledPoints += m;
+	}
+}
+
+void MandelCPU::subdivide(FillTile & t)
+{
+	// All rectangles of one level are processed together, so the kernel gets enough points at once.
+	std::vector<SubdivisionRect> rects(1);
+	std::vector<SubdivisionRect> next;
+	rects[0].x = 0;
+	rects[0].y = 0;
+	rects[0].w = t.w;
+	rects[0].h = t.h;
+	while(!rects.empty()){
+		for(size_t r = 0; r < rects.size(); r++){
+			const SubdivisionRect & rect = rects[r];
+			for(int col = rect.x; col < rect.x+rect.w; col++){
+				queuePoint(t, col, rect.y);
+				queuePoint(t, col, rect.y+rect.h-1);
+			}
+			for(int row = rect.y+1; row < rect.y+rect.h-1; row++){
+				queuePoint(t, rect.x, row);
+				queuePoint(t, rect.x+rect.w-1, row);
+			}
+		}
+		computeQueued(t);
+
+		next.clear();
+		for(size_t r = 0; r < rects.size(); r++){
+			const SubdivisionRect & rect = rects[r];
+			int x = rect.x, y = rect.y, w = rect.w, h = rect.h;
+			bool uniform = true;
+			int value = t.iterations[y*t.w + x];
+			for(int col = x; col < x+w && uniform; col++){
+				uniform = t.iterations[y*t.w + col] == value && t.iterations[(y+h-1)*t.w + col] == value;
+			}
+			for(int row = y+1; row < y+h-1 && uniform; row++){
+				uniform = t.iterations[row*t.w + x] == value && t.iterations[row*t.w + x+w-1] == value;
+			}
+			if(uniform){
+				// the border encloses no other iteration count (level sets of the escape time are connected)
+				uint64_t filled = 0;
+				for(int row = y+1; row < y+h-1; row++){
+					for(int col = x+1; col < x+w-1; col++){
+						int & i = t.iterations[row*t.w + col];
+						if(i == -1){
+							i = value;
+							filled++;
+						}
+					}
+				}
+				if(t.stats){
+					t.stats->filledPoints += filled;
+				}
+			}
+			else if(w <= MANDEL_CPU_SUBDIVISION_MIN_SIZE || h <= MANDEL_CPU_SUBDIVISION_MIN_SIZE){
+				// computed together with the next level
+				for(int row = y+1; row < y+h-1; row++){
+					for(int col = x+1; col < x+w-1; col++){
+						queuePoint(t, col, row);
+					}
+				}
+			}
+			else{// halves share the middle line
+				SubdivisionRect a = rect, b = rect;
+				if(w >= h){
+					int half = w/2;
+					a.w = half+1;
+					b.x = x+half;
+					b.w = w-half;
+				}
+				else{
+					int half = h/2;
+					a.h = half+1;
+					b.y = y+half;
+					b.h = h-half;
+				}
+				next.push_back(a);
+				next.push_back(b);
+			}
+		}
+		rects.swap(next);
+	}
+	computeQueued(t);
+}
+
+void MandelCPU::traceBoundaries(FillTile & t)
+{
+	// A pixel is traced if it differs from one of its neighbours, tracing computes its neighbours
+	// and continues with those that are on the edge of a band as well. Starting from the tile
+	// border this follows every band edge reachable from the border, everything else lies inside a
+	// band and gets the value of the band edge to its left.
+	// The pixels of one wave are computed together, so the kernel gets enough points at once.
+	std::vector<char> traced(t.w*t.h, 0);
+	std::vector<int> wave;
+	std::vector<int> next;
+	for(int col = 0; col < t.w; col++){
+		wave.push_back(col);
+		wave.push_back((t.h-1)*t.w + col);
+	}
+	for(int row = 1; row < t.h-1; row++){
+		wave.push_back(row*t.w);
+		wave.push_back(row*t.w + t.w-1);
+	}
+	for(size_t i = 0; i < wave.size(); i++){
+		traced[wave[i]] = 1;
+	}
+	while(!wave.empty()){
+		for(size_t i = 0; i < wave.size(); i++){
+			int x = wave[i]%t.w;
+			int y = wave[i]/t.w;
+			queuePoint(t, x, y);
+			if(x > 0) queuePoint(t, x-1, y);
+			if(x < t.w-1) queuePoint(t, x+1, y);
+			if(y > 0) queuePoint(t, x, y-1);
+			if(y < t.h-1) queuePoint(t, x, y+1);
+		}
+		computeQueued(t);
+
+		next.clear();
+		for(size_t i = 0; i < wave.size(); i++){
+			int p = wave[i];
+			int x = p%t.w;
+			int y = p/t.w;
+			int value = t.iterations[p];
+			bool l = x > 0 && t.iterations[p-1] != value;
+			bool r = x < t.w-1 && t.iterations[p+1] != value;
+			bool d = y > 0 && t.iterations[p-t.w] != value;
+			bool u = y < t.h-1 && t.iterations[p+t.w] != value;
+			int neighbours[8];
+			int n = 0;
+			if(l) neighbours[n++] = p-1;
+			if(r) neighbours[n++] = p+1;
+			if(d) neighbours[n++] = p-t.w;
+			if(u) neighbours[n++] = p+t.w;
+			// diagonal neighbours keep edges connected that only touch at a corner
+			if(x > 0 && y > 0 && (l || d)) neighbours[n++] = p-t.w-1;
+			if(x < t.w-1 && y > 0 && (r || d)) neighbours[n++] = p-t.w+1;
+			if(x > 0 && y < t.h-1 && (l || u)) neighbours[n++] = p+t.w-1;
+			if(x < t.w-1 && y < t.h-1 && (r || u)) neighbours[n++] = p+t.w+1;
+			for(int j = 0; j < n; j++){
+				if(!traced[neighbours[j]]){
+					traced[neighbours[j]] = 1;
+					next.push_back(neighbours[j]);
+				}
+			}
+		}
+		wave.swap(next);
+	}
+
+	// the left column is part of the border, so every row starts with a computed pixel
+	uint64_t filled = 0;
+	for(int row = 0; row < t.h; row++){
+		for(int col = 1; col < t.w; col++){
+			int & i = t.iterations[row*t.w + col];
+			if(i == -1){
+				i = t.iterations[row*t.w + col-1];
+				filled++;
+			}
+		}
+	}
+	if(t.stats){
+		t.stats->filledPoints += filled;
+	}
+}
+
+void MandelCPU::queuePoint(FillTile & t, int x, int y)
+{
+	int index = y*t.w + x;
+	if(t.iterations[index] != -1)// computed or already queued
+		return;
+	t.iterations[index] = -2;
+	double p[2];
+	// gl_FragCoord is at the pixel center
+	pixelToWorld(t.x + x + 0.5 + _sampleMap[0], t.y + y + 0.5 + _sampleMap[1], p);
+	t.queue.push_back(index);
+	t.px.push_back(p[0]);
+	t.py.push_back(p[1]);
+}
+
+void MandelCPU::computeQueued(FillTile & t)
+{
+	int n = static_cast<int>(t.queue.size());
+	if(n == 0)
+		return;
+	t.result.resize(n);
+	t.kernel(t.params, &t.px[0], &t.py[0], n, &t.result[0], t.stats);
+	for(int i = 0; i < n; i++){
+		t.iterations[t.queue[i]] = t.result[i];
+	}
+	if(t.stats){
+		t.stats->iteratedPoints += n;
+	}
+	t.queue.clear();
+	t.px.clear();
+	t.py.clear();
+}
+
+void MandelCPU::addColor(int iterations, float * color)
+{
+	float s = 1;
+	if(iterations < _maxIterations && _maxIterations > 1){
+		s = static_cast<float>(iterations)/(_maxIterations-1) + _colorOffset;
+		if(s > 1)
+			s -= 1;
+	}
+	float rgb[3];
+	sampleColorMap(s, rgb);
+	color[0] += rgb[0];
+	color[1] += rgb[1];
+	color[2] += rgb[2];
+}
+
+uint32_t MandelCPU::packColor(const float * color)
+{
+	uint32_t pixel = 0xFF000000;
+	for(int c = 0; c < 3; c++){
+		int v = static_cast<int>(color[c]/_numSamples*255.f + 0.5f);
+		if(v > 255) v = 255;
+		pixel |= static_cast<uint32_t>(v)<<(c*8);
+	}
+	return pixel;
+}
+
+void MandelCPU::pixelToDelta(double x, double y, double * delta)
+{
+	double p[2];
+	p[0] = 2*x/_windowW - 1;
+	p[1] = 2*y/_windowH - 1;
+	delta[0] = _transform[0]*p[0] + _transform[3]*p[1];
+	delta[1] = _transform[1]*p[0] + _transform[4]*p[1];
+}
+
+void MandelCPU::renderPerturbation(uint32_t * rgba, MandelTileScheduler * scheduler)
+{
+	// reference orbit at the view center, precision chosen from the pixel size
+	double spacing = getPixelSize();
+	int limbs = MandelBigFixed::getLimbsForResolution(spacing);
+	MandelBigFixed center_x = _center[0];
+	MandelBigFixed center_y = _center[1];
+	center_x.setLimbs(limbs);
+	center_y.setLimbs(limbs);
+	computeReferenceOrbit(_orbit, center_x, center_y, _julia, _juliaC, _maxIterations);
+	_stats.referenceOrbits++;
+	_orbitOffset[0] = 0;
+	_orbitOffset[1] = 0;
+	_series = MandelSeriesApproximation();
+	if(_seriesApproximation){
+		// largest offset: window corner plus one pixel for the sample positions
+		double radius = hypot(fabs(_transform[0]) + fabs(_transform[3]), fabs(_transform[1]) + fabs(_transform[4]));
+		double spacing_x = 2*fabs(_transform[0])/_windowW;
+		double spacing_y = 2*fabs(_transform[4])/_windowH;
+		radius += spacing_x > spacing_y ? spacing_x : spacing_y;
+		computeSeriesApproximation(_series, _orbit, _julia, radius, spacing, _seriesTolerance, _maxIterations);
+	}
+
+	// all samples relative to the center reference
+	_renderTarget = rgba;
+	_sampleIterations.resize(_windowW*_windowH*_numSamples);
+	if(scheduler){
+		scheduler->run(_windowW, _windowH, MANDEL_CPU_TILE_SIZE, perturbationTile, this);
+	}
+	else{
+		MandelTile t = {0, 0, _windowW, _windowH};
+		perturbationTile(t, 0, this);
+	}
+
+	// re-referencing glitched samples until all are resolved
+	_glitched.clear();
+	for(size_t i = 0; i < _sampleIterations.size(); i++){
+		if(_sampleIterations[i] == MANDEL_GLITCH)
+			_glitched.push_back(static_cast<int>(i));
+	}
+	_stats.glitchedPoints += _glitched.size();
+	for(int r = 0; r < _maxReferences && !_glitched.empty(); r++){
+		// new reference at one of the glitched samples, which cannot glitch against itself
+		double ref_delta[2];
+		sampleToDelta(_glitched[_glitched.size()/2], ref_delta);
+		MandelBigFixed ref_x(ref_delta[0], limbs);
+		MandelBigFixed ref_y(ref_delta[1], limbs);
+		MandelBigFixed::add(center_x, ref_x, ref_x);
+		MandelBigFixed::add(center_y, ref_y, ref_y);
+		computeReferenceOrbit(_orbit, ref_x, ref_y, _julia, _juliaC, _maxIterations);
+		_stats.referenceOrbits++;
+		_orbitOffset[0] = ref_delta[0];
+		_orbitOffset[1] = ref_delta[1];
+		if(scheduler){
+			scheduler->run(static_cast<int>(_glitched.size()), 1, MANDEL_CPU_TILE_SIZE*MANDEL_CPU_TILE_SIZE, glitchTile, this);
+		}
+		else{
+			MandelTile t = {0, 0, static_cast<int>(_glitched.size()), 1};
+			glitchTile(t, 0, this);
+		}
+		size_t remaining = 0;
+		for(size_t i = 0; i < _glitched.size(); i++){
+			if(_sampleIterations[_glitched[i]] == MANDEL_GLITCH)
+				_glitched[remaining++] = _glitched[i];
+		}
+		_glitched.resize(remaining);
+	}
+	// out of references, falling back to plain double precision
+	for(size_t i = 0; i < _glitched.size(); i++){
+		double p[2];
+		sampleToDelta(_glitched[i], p);
+		p[0] += _transform[6];
+		p[1] += _transform[7];
+		MandelKernelParams params;
+		params.maxIterations = _maxIterations;
+		params.julia = _julia;
+		params.juliaC[0] = _juliaC[0];
+		params.juliaC[1] = _juliaC[1];
+		params.laneRefill = false;
+		params.interiorCheck = _interiorCheck;
+		params.periodicityTolerance = 0;
+		mandelKernelScalarDouble(params, &p[0], &p[1], 1, &_sampleIterations[_glitched[i]], NULL);
+	}
+
+	// coloring
+	for(int i = 0; i < _windowW*_windowH; i++){
+		float color[3] = {0, 0, 0};
+		for(int s = 0; s < _numSamples; s++){
+			addColor(_sampleIterations[i*_numSamples + s], color);
+		}
+		rgba[i] = packColor(color);
+	}
+}
+
+void MandelCPU::sampleToDelta(int sample_index, double * delta)
+{
+	int pixel = sample_index/_numSamples;
+	int s = sample_index%_numSamples;
+	// gl_FragCoord is at the pixel center
+	pixelToDelta(pixel%_windowW + 0.5 + _sampleMap[s*2 + 0], pixel/_windowW + 0.5 + _sampleMap[s*2 + 1], delta);
+}
+
+void MandelCPU::perturbationTile(const MandelTile & tile, int /*worker*/, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	for(int y = tile.y; y < tile.y+tile.h; y++){
+		for(int x = tile.x; x < tile.x+tile.w; x++){
+			int index = (y*cpu->_windowW + x)*cpu->_numSamples;
+			for(int s = 0; s < cpu->_numSamples; s++){
+				double delta[2];
+				cpu->sampleToDelta(index+s, delta);
+				cpu->_sampleIterations[index+s] = perturbationEscapeTime(cpu->_orbit, delta[0], delta[1], cpu->_julia, cpu->_maxIterations, &cpu->_series);
+			}
+		}
+	}
+}
+
+void MandelCPU::glitchTile(const MandelTile & tile, int /*worker*/, void * user)
+{
+	MandelCPU * cpu = static_cast<MandelCPU*>(user);
+	for(int i = tile.x; i < tile.x+tile.w; i++){
+		int index = cpu->_glitched[i];
+		double delta[2];
+		cpu->sampleToDelta(index, delta);
+		cpu->_sampleIterations[index] = perturbationEscapeTime(cpu->_orbit,
+			delta[0]-cpu->_orbitOffset[0], delta[1]-cpu->_orbitOffset[1], cpu->_julia, cpu->_maxIterations);
+	}
+}
@@ -0,0 +1,198 @@
+#ifndef MANDEL_CPU_H
+#define MANDEL_CPU_H
+
+#include "mandel_cpu_kernel.h"
+#include "mandel_tile_scheduler.h"
+#include "mandel_perturbation.h"
+#include "mandel_escape_data.h"
+#include "mandel_tile_cache.h"
+#include <stdint.h>
+#include <vector>
+
+// size of the tiles distributed over the threads
+#define MANDEL_CPU_TILE_SIZE 32
+
+// rectangles up to this width or height are not subdivided any further
+#define MANDEL_CPU_SUBDIVISION_MIN_SIZE 4
+
+// how pixels of a tile are computed
+enum MandelCPUStrategy{
+	MANDEL_CPU_BRUTE_FORCE = 0,// every pixel is iterated
+	MANDEL_CPU_SUBDIVISION,// Mariani-Silver: rectangles with a uniform border are filled
+	MANDEL_CPU_BOUNDARY_TRACING,// only the edges between iteration bands are iterated, the bands are filled
+	NUM_MANDEL_CPU_STRATEGIES
+};
+const char * getMandelCPUStrategyName(MandelCPUStrategy strategy);
+// returns NUM_MANDEL_CPU_STRATEGIES if name is unknown
+MandelCPUStrategy getMandelCPUStrategy(const char * name);
+
+// default error of the series approximation in pixels
+#define MANDEL_CPU_SERIES_TOLERANCE 0.001
+
+// CPU escape-time renderer, reproduces MANDEL_FRAGMENT_SHADER without an OpenGL context.
+// The setters take the same values as the corresponding MandelShader uniforms.
+// Output pixels are RGBA (red in the lowest byte) with the bottom row first, just like glReadPixels.
+class MandelCPU{
+public:
+	MandelCPU();
+	void setWindowSize(int w, int h){_windowW = w; _windowH = h;}
+	void setTransform(const double * mat3);
+	// view center in full precision, used instead of the translation of the transform by perturbation
+	// (call after setTransform)
+	void setCenter(const MandelBigFixed & x, const MandelBigFixed & y);
+	void setMaxIterations(int max_i){_maxIterations = max_i;}
+	void setJuliaC(const double * c){_juliaC[0] = c[0]; _juliaC[1] = c[1];}
+	void setJulia(bool enabled){_julia = enabled;}
+	void setDoublePrecision(bool d){_doublePrecision = d;}
+	// select escape-time kernel, MANDEL_KERNEL_AUTO picks the widest one supported by the cpu
+	void setKernel(MandelKernelType type){_kernelType = resolveMandelKernelType(type);}
+	MandelKernelType getKernel(){return _kernelType;}
+	// refill escaped lanes of the vectorized kernels with new pixels
+	void setLaneRefill(bool enabled){_laneRefill = enabled;}
+	// skip points inside the main cardioid and the period-2 bulb (Mandelbrot only, not used by perturbation)
+	void setInteriorCheck(bool enabled){_interiorCheck = enabled;}
+	// stop iterating once the orbit comes back within tolerance pixels of an earlier point (0: off)
+	void setPeriodicityCheck(double tolerance){_periodicityTolerance = tolerance;}
+	// strategies other than brute force fill pixels without iterating them, so they are only used
+	// with one sample per pixel and not by perturbation
+	void setStrategy(MandelCPUStrategy strategy){_strategy = strategy;}
+	MandelCPUStrategy getStrategy(){return _strategy;}
+	// deep zoom: pixels are iterated as double precision offsets to a high precision reference orbit
+	// at the view center, glitched pixels get new references (at most max_references)
+	void setPerturbation(bool enabled){_perturbation = enabled;}
+	void setMaxReferences(int max_references){_maxReferences = max_references;}
+	// skip the first iterations of all pixels with a series approximation of the reference orbit (implies perturbation),
+	// tolerance is the allowed approximation error in pixels
+	void setSeriesApproximation(bool enabled){_seriesApproximation = enabled;}
+	void setSeriesTolerance(double tolerance){_seriesTolerance = tolerance;}
+	// iterations skipped in the last render
+	int getSeriesSkip(){return _series.skip;}
+	void setNumSamples(unsigned int n);
+	// with more than one sample, compute one sample per pixel first and multisample only pixels
+	// whose 3x3 neighbourhood differs in iterations (not used by perturbation)
+	void setAdaptiveSampling(bool enabled){_adaptiveSampling = enabled;}
+	bool getAdaptiveSampling(){return _adaptiveSampling;}
+	// colors as stored in MandelbrotSettings::colors, nearest selects GL_NEAREST instead of GL_LINEAR filtering
+	void setColorMap(const uint32_t * colors, int num_colors, bool nearest);
+	// shift of the color map for escaped points (0..1)
+	void setColorOffset(float offset){_colorOffset = offset;}
+
+	// render the whole window, rgba must hold window_w*window_h pixels,
+	// tiles are spread over the threads of scheduler (NULL renders on the calling thread)
+	void render(uint32_t * rgba, MandelTileScheduler * scheduler = NULL);
+	// render rows [y, y+h) of the window into rgba (window_w*h pixels), e.g. bands of an image too large
+	// to be kept in memory (not with perturbation, its reference orbits are chosen for the whole window)
+	void renderRows(int y, int h, uint32_t * rgba, MandelTileScheduler * scheduler = NULL);
+	// render the rectangle [x, x+w) x [y, y+h) into rgba (stride given in pixels),
+	// kernel counters are added to stats
+	void renderRect(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats);
+	// render n points given in fractal coordinates (one sample each), e.g. on a non-rectangular grid
+	void renderPoints(const double * x, const double * y, int n, uint32_t * rgba, MandelKernelStats * stats);
+	// escape data of the whole window (window_w*window_h pixels, one sample at each pixel center, double precision,
+	// not with perturbation)
+	void renderEscapeData(MandelEscapePixel * pixels, MandelTileScheduler * scheduler = NULL);
+	// render the whole window with one sample per pixel from the nearest sample of the tile pyramid level whose
+	// spacing is closest to the pixel size (double precision, not with perturbation). Tiles missing in cache are
+	// computed and added. Views zoomed out beyond level 0 are rendered by render() without the cache.
+	void renderCached(uint32_t * rgba, MandelTileCache & cache, MandelTileScheduler * scheduler = NULL);
+	// colors escape data with the color map, color offset and max iterations, using the smooth iteration count
+	void colorEscapeData(const MandelEscapePixel * pixels, int n, uint32_t * rgba);
+
+	// kernel counters accumulated over all renders since the last reset
+	const MandelKernelStats & getStats(){return _stats;}
+	void resetStats(){_stats.reset();}
+private:
+	// window coordinates -> fractal coordinates (gl_FragCoord.xy = (x, y))
+	void pixelToWorld(double x, double y, double * world);
+	// distance of neighbouring pixels in fractal coordinates (smaller one of x and y)
+	double getPixelSize();
+	// window coordinates -> offset from the view center
+	void pixelToDelta(double x, double y, double * delta);
+	void sampleColorMap(float s, float * rgb);
+	// adds color of the iteration count to color (rgb)
+	void addColor(int iterations, float * color);
+	// averages color over the samples and converts to rgba
+	uint32_t packColor(const float * color);
+	static void renderTile(const MandelTile & tile, int worker, void * user);
+	static void escapeDataTile(const MandelTile & tile, int worker, void * user);
+	// tile.x spans the missing pyramid tiles side by side
+	static void cacheTile(const MandelTile & tile, int worker, void * user);
+	static void cachedPixelsTile(const MandelTile & tile, int worker, void * user);
+	void getKernelParams(MandelKernelParams & params);
+
+	// tile rendered by a strategy that fills pixels without iterating them,
+	// tiles are independent since their borders are always iterated
+	struct FillTile{
+		int x, y, w, h;// in window coordinates
+		std::vector<int> iterations;// per pixel of the tile, -1: not computed, -2: queued
+		// points waiting for the kernel
+		std::vector<int> queue;
+		std::vector<double> px;
+		std::vector<double> py;
+		std::vector<int> result;
+		MandelKernel kernel;
+		MandelKernelParams params;
+		MandelKernelStats * stats;
+	};
+	void renderRectFilled(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats);
+	void renderRectAdaptive(int x, int y, int w, int h, uint32_t * rgba, int stride, MandelKernelStats * stats);
+	// rectangle [x, x+w) x [y, y+h) in tile coordinates
+	struct SubdivisionRect{
+		int x, y, w, h;
+	};
+	void subdivide(FillTile & t);
+	void traceBoundaries(FillTile & t);
+	void queuePoint(FillTile & t, int x, int y);
+	void computeQueued(FillTile & t);
+
+	void renderPerturbation(uint32_t * rgba, MandelTileScheduler * scheduler);
+	// sample index (pixel*num_samples + sample) -> offset from the view center
+	void sampleToDelta(int sample_index, double * delta);
+	static void perturbationTile(const MandelTile & tile, int worker, void * user);
+	// tile.x/tile.w select a range of _glitched
+	static void glitchTile(const MandelTile & tile, int worker, void * user);
+	int _windowW;
+	int _windowH;
+	double _transform[9];
+	MandelBigFixed _center[2];
+	int _maxIterations;
+	double _juliaC[2];
+	bool _julia;
+	bool _doublePrecision;
+	MandelKernelType _kernelType;
+	bool _laneRefill;
+	bool _interiorCheck;
+	double _periodicityTolerance;// in pixels
+	MandelCPUStrategy _strategy;
+	bool _perturbation;
+	int _maxReferences;
+	MandelReferenceOrbit _orbit;
+	double _orbitOffset[2];// current reference relative to the view center
+	bool _seriesApproximation;
+	double _seriesTolerance;
+	MandelSeriesApproximation _series;
+	std::vector<int> _sampleIterations;
+	std::vector<int> _glitched;// indices into _sampleIterations
+	MandelKernelStats _stats;
+	std::vector<MandelKernelStats> _workerStats;
+	uint32_t * _renderTarget;
+	int _renderY;// first row of _renderTarget in the window
+	MandelEscapePixel * _escapeTarget;
+	// pyramid tiles of renderCached
+	int _cacheLevel;
+	int64_t _cacheOrigin[2];// first tile
+	int _cacheTilesX;
+	int _cacheTilesY;
+	std::vector<int32_t> _cacheData;// iteration counts, MANDEL_TILE_CACHE_TILE_SIZE^2 per tile
+	std::vector<int> _cacheMissing;// indices of the tiles to compute
+	std::vector<uint32_t> _cacheColors;// per iteration count
+	int _numSamples;
+	const float * _sampleMap;
+	bool _adaptiveSampling;
+	std::vector<float> _colorMap;// 3 floats per color
+	int _numColors;
+	bool _nearest;
+	float _colorOffset;
+};
+
+#endif
@@ -0,0 +1,46 @@
+// compiled with -mavx2
+#include "mandel_cpu_simd.h"
+#include <immintrin.h>
+
+struct VecAVX2Float{
+	enum{WIDTH = 8};
+	typedef __m256 Real;
+	static Real set1(double d){return _mm256_set1_ps(static_cast<float>(d));}
+	static Real load(const double * p){
+		__m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(p));
+		__m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(p+4));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+	static void store(double * p, Real v){
+		_mm256_storeu_pd(p, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+		_mm256_storeu_pd(p+4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+	}
+	static Real add(Real a, Real b){return _mm256_add_ps(a, b);}
+	static Real sub(Real a, Real b){return _mm256_sub_ps(a, b);}
+	static Real mul(Real a, Real b){return _mm256_mul_ps(a, b);}
+	static int cmpgt(Real a, Real b){return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ));}
+	static int cmpge(Real a, Real b){return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ));}
+};
+
+struct VecAVX2Double{
+	enum{WIDTH = 4};
+	typedef __m256d Real;
+	static Real set1(double d){return _mm256_set1_pd(d);}
+	static Real load(const double * p){return _mm256_loadu_pd(p);}
+	static void store(double * p, Real v){_mm256_storeu_pd(p, v);}
+	static Real add(Real a, Real b){return _mm256_add_pd(a, b);}
+	static Real sub(Real a, Real b){return _mm256_sub_pd(a, b);}
+	static Real mul(Real a, Real b){return _mm256_mul_pd(a, b);}
+	static int cmpgt(Real a, Real b){return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));}
+	static int cmpge(Real a, Real b){return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GE_OQ));}
+};
+
+void mandelKernelAVX2Float(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	runSimdKernel<VecAVX2Float>(params, x, y, n, iterations, stats);
+}
+
+void mandelKernelAVX2Double(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	runSimdKernel<VecAVX2Double>(params, x, y, n, iterations, stats);
+}
@@ -0,0 +1,49 @@
+// compiled with -mavx512f
+#include "mandel_cpu_simd.h"
+#include <immintrin.h>
+
+struct VecAVX512Float{
+	enum{WIDTH = 16};
+	typedef __m512 Real;
+	static Real set1(double d){return _mm512_set1_ps(static_cast<float>(d));}
+	static Real load(const double * p){
+		float f[WIDTH];
+		for(int i = 0; i < WIDTH; i++)
+			f[i] = static_cast<float>(p[i]);
+		return _mm512_loadu_ps(f);
+	}
+	static void store(double * p, Real v){
+		float f[WIDTH];
+		_mm512_storeu_ps(f, v);
+		for(int i = 0; i < WIDTH; i++)
+			p[i] = f[i];
+	}
+	static Real add(Real a, Real b){return _mm512_add_ps(a, b);}
+	static Real sub(Real a, Real b){return _mm512_sub_ps(a, b);}
+	static Real mul(Real a, Real b){return _mm512_mul_ps(a, b);}
+	static int cmpgt(Real a, Real b){return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);}
+	static int cmpge(Real a, Real b){return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);}
+};
+
+struct VecAVX512Double{
+	enum{WIDTH = 8};
+	typedef __m512d Real;
+	static Real set1(double d){return _mm512_set1_pd(d);}
+	static Real load(const double * p){return _mm512_loadu_pd(p);}
+	static void store(double * p, Real v){_mm512_storeu_pd(p, v);}
+	static Real add(Real a, Real b){return _mm512_add_pd(a, b);}
+	static Real sub(Real a, Real b){return _mm512_sub_pd(a, b);}
+	static Real mul(Real a, Real b){return _mm512_mul_pd(a, b);}
+	static int cmpgt(Real a, Real b){return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);}
+	static int cmpge(Real a, Real b){return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);}
+};
+
+void mandelKernelAVX512Float(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	runSimdKernel<VecAVX512Float>(params, x, y, n, iterations, stats);
+}
+
+void mandelKernelAVX512Double(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	runSimdKernel<VecAVX512Double>(params, x, y, n, iterations, stats);
+}
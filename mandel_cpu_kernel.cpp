@@ -0,0 +1,186 @@
+#include "mandel_cpu_kernel.h"
+#include <string.h>
+
+// Brent's cycle detection (as is_periodic() in the shaders): returns true if z is within tolerance
+// of the saved orbit point, the saved point is moved to z at iteration check, check doubles
+template<typename T>
+static inline bool isPeriodic(T zx, T zy, T & saved_x, T & saved_y, int i, int64_t & check, T tolerance2)
+{
+	T dx = zx - saved_x;
+	T dy = zy - saved_y;
+	if(dx*dx + dy*dy < tolerance2)
+		return true;
+	if(i == check){
+		saved_x = zx;
+		saved_y = zy;
+		check *= 2;
+	}
+	return false;
+}
+
+// number of iterations until |z|^2 exceeds 4 (same loop as in MANDEL_FRAGMENT_SHADER),
+// max_iterations if the point did not escape, periodic is set if a cycle was detected,
+// the final |z|^2 is written to norm if it is not NULL
+template<typename T>
+static int escapeTime(T px, T py, bool julia, T cx, T cy, int max_iterations, T tolerance2, bool & periodic, T * norm = NULL)
+{
+	T zx, zy;
+	int64_t check = 1;
+	periodic = false;
+	if(julia){
+		zx = px; zy = py;
+		T saved_x = zx, saved_y = zy;
+		for(int i = 0; i < max_iterations; i++){
+			if(zx*zx + zy*zy >= T(4)){
+				if(norm) *norm = zx*zx + zy*zy;
+				return i;
+			}
+			T x = zx*zx - zy*zy + cx;
+			zy = 2*zx*zy + cy;
+			zx = x;
+			if(tolerance2 > 0 && isPeriodic(zx, zy, saved_x, saved_y, i, check, tolerance2)){
+				periodic = true;
+				break;
+			}
+		}
+	}
+	else{
+		zx = 0; zy = 0;
+		T saved_x = zx, saved_y = zy;
+		for(int i = 0; i < max_iterations; i++){
+			if(zx*zx + zy*zy > T(4)){
+				if(norm) *norm = zx*zx + zy*zy;
+				return i;
+			}
+			T x = zx*zx - zy*zy + px;
+			zy = 2*zx*zy + py;
+			zx = x;
+			if(tolerance2 > 0 && isPeriodic(zx, zy, saved_x, saved_y, i, check, tolerance2)){
+				periodic = true;
+				break;
+			}
+		}
+	}
+	if(norm) *norm = zx*zx + zy*zy;
+	return max_iterations;
+}
+
+template<typename T>
+static void scalarKernel(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	uint64_t steps = 0;
+	uint64_t interior = 0;
+	uint64_t periodic_points = 0;
+	bool interior_check = params.interiorCheck && !params.julia;
+	T tolerance2 = static_cast<T>(params.periodicityTolerance*params.periodicityTolerance);
+	for(int i = 0; i < n; i++){
+		if(interior_check && isInCardioidOrBulb(x[i], y[i])){
+			iterations[i] = params.maxIterations;
+			interior++;
+			continue;
+		}
+		bool periodic;
+		iterations[i] = escapeTime<T>(x[i], y[i], params.julia, params.juliaC[0], params.juliaC[1], params.maxIterations, tolerance2, periodic);
+		steps += iterations[i];
+		if(periodic)
+			periodic_points++;
+	}
+	if(stats){
+		stats->laneSteps += steps;
+		stats->activeLaneSteps += steps;
+		stats->interiorPoints += interior;
+		stats->periodicPoints += periodic_points;
+	}
+}
+
+void mandelKernelScalarFloat(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	scalarKernel<float>(params, x, y, n, iterations, stats);
+}
+
+void mandelKernelScalarDouble(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	scalarKernel<double>(params, x, y, n, iterations, stats);
+}
+
+void mandelKernelEscapeData(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, double * norms, MandelKernelStats * stats)
+{
+	uint64_t steps = 0;
+	bool interior_check = params.interiorCheck && !params.julia;
+	double tolerance2 = params.periodicityTolerance*params.periodicityTolerance;
+	for(int i = 0; i < n; i++){
+		if(interior_check && isInCardioidOrBulb(x[i], y[i])){
+			iterations[i] = params.maxIterations;
+			norms[i] = 0;
+			continue;
+		}
+		bool periodic;
+		iterations[i] = escapeTime<double>(x[i], y[i], params.julia, params.juliaC[0], params.juliaC[1], params.maxIterations, tolerance2, periodic, &norms[i]);
+		steps += iterations[i];
+	}
+	if(stats){
+		stats->laneSteps += steps;
+		stats->activeLaneSteps += steps;
+	}
+}
+
+static const char * MANDEL_KERNEL_NAMES[NUM_MANDEL_KERNELS] = {
+	"auto",
+	"scalar",
+	"avx2",
+	"avx512"
+};
+
+bool isMandelKernelSupported(MandelKernelType type)
+{
+	switch(type){
+	case MANDEL_KERNEL_SCALAR: return true;
+#ifdef MANDEL_CPU_X86_SIMD
+	case MANDEL_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+	case MANDEL_KERNEL_AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+	default: return false;
+	}
+}
+
+MandelKernelType resolveMandelKernelType(MandelKernelType type)
+{
+	if(type != MANDEL_KERNEL_AUTO && isMandelKernelSupported(type)){
+		return type;
+	}
+	// picking widest supported kernel
+	for(int t = NUM_MANDEL_KERNELS-1; t > MANDEL_KERNEL_SCALAR; t--){
+		if(isMandelKernelSupported(static_cast<MandelKernelType>(t))){
+			return static_cast<MandelKernelType>(t);
+		}
+	}
+	return MANDEL_KERNEL_SCALAR;
+}
+
+MandelKernel getMandelKernel(MandelKernelType type, bool double_precision)
+{
+	switch(resolveMandelKernelType(type)){
+#ifdef MANDEL_CPU_X86_SIMD
+	case MANDEL_KERNEL_AVX2: return double_precision ? mandelKernelAVX2Double : mandelKernelAVX2Float;
+	case MANDEL_KERNEL_AVX512: return double_precision ? mandelKernelAVX512Double : mandelKernelAVX512Float;
+#endif
+	default: return double_precision ? mandelKernelScalarDouble : mandelKernelScalarFloat;
+	}
+}
+
+const char * getMandelKernelName(MandelKernelType type)
+{
+	if(type < 0 || type >= NUM_MANDEL_KERNELS)
+		return "unknown";
+	return MANDEL_KERNEL_NAMES[type];
+}
+
+MandelKernelType getMandelKernelType(const char * name)
+{
+	for(int t = 0; t < NUM_MANDEL_KERNELS; t++){
+		if(!strcmp(name, MANDEL_KERNEL_NAMES[t])){
+			return static_cast<MandelKernelType>(t);
+		}
+	}
+	return NUM_MANDEL_KERNELS;
+}
@@ -0,0 +1,98 @@
+#ifndef MANDEL_CPU_KERNEL_H
+#define MANDEL_CPU_KERNEL_H
+
+// escape-time kernels used by MandelCPU
+
+#include <stdint.h>
+
+struct MandelKernelParams{
+	int maxIterations;
+	bool julia;
+	double juliaC[2];
+	// vectorized kernels: load the next point into a lane as soon as it escapes
+	// instead of waiting for all lanes of the vector
+	bool laneRefill;
+	// Mandelbrot only: skip points inside the main cardioid or the period-2 bulb
+	bool interiorCheck;
+	// stop once z comes back within this distance of an earlier orbit point, 0 disables the check
+	double periodicityTolerance;
+};
+
+// closed form test for the main cardioid and the period-2 bulb, points inside never escape
+inline bool isInCardioidOrBulb(double x, double y)
+{
+	double xq = x - 0.25;
+	double q = xq*xq + y*y;
+	if(q*(q + xq) <= 0.25*y*y)
+		return true;
+	return (x + 1.0)*(x + 1.0) + y*y <= 0.0625;
+}
+
+// counters accumulated by the kernels and MandelCPU
+struct MandelKernelStats{
+	MandelKernelStats(){reset();}
+	void reset(){laneSteps = 0; activeLaneSteps = 0; interiorPoints = 0; periodicPoints = 0; iteratedPoints = 0; filledPoints = 0; supersampledPoints = 0; referenceOrbits = 0; glitchedPoints = 0;}
+	void add(const MandelKernelStats & s){
+		laneSteps += s.laneSteps;
+		activeLaneSteps += s.activeLaneSteps;
+		interiorPoints += s.interiorPoints;
+		periodicPoints += s.periodicPoints;
+		iteratedPoints += s.iteratedPoints;
+		filledPoints += s.filledPoints;
+		supersampledPoints += s.supersampledPoints;
+		referenceOrbits += s.referenceOrbits;
+		glitchedPoints += s.glitchedPoints;
+	}
+	// fraction of vector lanes doing useful work
+	double getLaneUtilisation() const {return laneSteps > 0 ? activeLaneSteps/static_cast<double>(laneSteps) : 1.0;}
+	// fraction of the pixels that was actually iterated
+	double getIteratedFraction() const {
+		uint64_t total = iteratedPoints + filledPoints;
+		return total > 0 ? iteratedPoints/static_cast<double>(total) : 1.0;
+	}
+	uint64_t laneSteps;// iterations executed by all lanes (vector iterations*width)
+	uint64_t activeLaneSteps;// iterations executed by lanes holding a point that has not escaped yet
+	uint64_t interiorPoints;// points skipped by the cardioid/bulb check
+	uint64_t periodicPoints;// points stopped by the periodicity check
+	uint64_t iteratedPoints;// MandelCPU: points passed to a kernel
+	uint64_t filledPoints;// MandelCPU: pixels filled by subdivision without iterating
+	uint64_t supersampledPoints;// MandelCPU: pixels multisampled by adaptive sampling
+	uint64_t referenceOrbits;// perturbation: reference orbits computed
+	uint64_t glitchedPoints;// perturbation: points that needed another reference
+};
+
+// computes the escape iteration of n points (x[i], y[i]) like the loop in MANDEL_FRAGMENT_SHADER,
+// iterations[i] is set to maxIterations if the point did not escape, stats may be NULL
+typedef void (*MandelKernel)(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+
+enum MandelKernelType{
+	MANDEL_KERNEL_AUTO = 0,// widest kernel supported by the cpu
+	MANDEL_KERNEL_SCALAR,
+	MANDEL_KERNEL_AVX2,
+	MANDEL_KERNEL_AVX512,
+	NUM_MANDEL_KERNELS
+};
+
+// returns the kernel for the given type (scalar kernel if the type is not supported)
+MandelKernel getMandelKernel(MandelKernelType type, bool double_precision);
+// resolves MANDEL_KERNEL_AUTO and kernels not supported by the cpu/build
+MandelKernelType resolveMandelKernelType(MandelKernelType type);
+bool isMandelKernelSupported(MandelKernelType type);
+const char * getMandelKernelName(MandelKernelType type);
+// returns NUM_MANDEL_KERNELS if name is unknown
+MandelKernelType getMandelKernelType(const char * name);
+
+// scalar reference kernels
+void mandelKernelScalarFloat(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+void mandelKernelScalarDouble(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+
+// scalar double kernel that also writes the final |z|^2 of every point to norms (for escape data export)
+void mandelKernelEscapeData(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, double * norms, MandelKernelStats * stats);
+
+// vectorized kernels (only available if MANDEL_CPU_X86_SIMD is defined)
+void mandelKernelAVX2Float(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+void mandelKernelAVX2Double(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+void mandelKernelAVX512Float(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+void mandelKernelAVX512Double(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats);
+
+#endif
@@ -0,0 +1,295 @@
+#ifndef MANDEL_CPU_SIMD_H
+#define MANDEL_CPU_SIMD_H
+
+#include "mandel_cpu_kernel.h"
+
+// Generic vectorized escape-time loop, included by the translation units that are compiled
+// for a specific instruction set. V wraps the intrinsics of one vector type:
+//  V::WIDTH           number of lanes
+//  V::Real            vector register type
+//  V::set1(d)         broadcast
+//  V::load(p)         load WIDTH doubles (converted to the lane type)
+//  V::store(p, v)     store WIDTH lanes as doubles
+//  V::add/sub/mul     arithmetic
+//  V::cmpgt/cmpge     compare, returns one bit per lane
+
+// Every lane iterates until all lanes have escaped or reached max_iterations,
+// escaped lanes are masked out and their iteration count is recorded when they escape.
+template<class V>
+void simdKernelMasked(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	typedef typename V::Real Real;
+	const int all_lanes = (1<<V::WIDTH)-1;
+	const Real four = V::set1(4.0);
+	const bool interior_check = params.interiorCheck && !params.julia;
+	const bool periodicity_check = params.periodicityTolerance > 0;
+	const Real tolerance2 = V::set1(params.periodicityTolerance*params.periodicityTolerance);
+	double px[V::WIDTH];
+	double py[V::WIDTH];
+	MandelKernelStats local_stats;
+	for(int start = 0; start < n; start += V::WIDTH){
+		int count = n-start;
+		if(count > V::WIDTH)
+			count = V::WIDTH;
+		// padding last block by repeating the last point
+		for(int l = 0; l < V::WIDTH; l++){
+			int src = start + (l < count ? l : count-1);
+			px[l] = x[src];
+			py[l] = y[src];
+		}
+		int * out = iterations + start;
+		Real zx, zy, cx, cy;
+		if(params.julia){
+			zx = V::load(px);
+			zy = V::load(py);
+			cx = V::set1(params.juliaC[0]);
+			cy = V::set1(params.juliaC[1]);
+		}
+		else{
+			zx = V::set1(0.0);
+			zy = V::set1(0.0);
+			cx = V::load(px);
+			cy = V::load(py);
+		}
+		// lanes that already escaped (padding lanes are done from the start)
+		int done = all_lanes & ~((1<<count)-1);
+		if(interior_check){// interior points are done as well, they keep max_iterations
+			for(int l = 0; l < count; l++){
+				if(isInCardioidOrBulb(px[l], py[l])){
+					out[l] = params.maxIterations;
+					done |= 1<<l;
+					local_stats.interiorPoints++;
+				}
+			}
+			if(done == all_lanes)
+				continue;
+		}
+		// periodicity check, same schedule for all lanes
+		Real saved_x = zx;
+		Real saved_y = zy;
+		int64_t check = 1;
+		int i = 0;
+		for(; i < params.maxIterations; i++){
+			local_stats.laneSteps += V::WIDTH;
+			local_stats.activeLaneSteps += __builtin_popcount(~done & all_lanes);
+			Real zx2 = V::mul(zx, zx);
+			Real zy2 = V::mul(zy, zy);
+			Real len = V::add(zx2, zy2);
+			int escaped = params.julia ? V::cmpge(len, four) : V::cmpgt(len, four);
+			int newly_escaped = escaped & ~done;
+			if(newly_escaped){
+				for(int l = 0; l < count; l++){
+					if(newly_escaped & (1<<l)){
+						out[l] = i;
+					}
+				}
+				done |= newly_escaped;
+				if(done == all_lanes){
+					break;
+				}
+			}
+			Real zxy = V::mul(zx, zy);
+			zx = V::add(V::sub(zx2, zy2), cx);
+			zy = V::add(V::add(zxy, zxy), cy);
+			if(periodicity_check){
+				Real dx = V::sub(zx, saved_x);
+				Real dy = V::sub(zy, saved_y);
+				int periodic = V::cmpgt(tolerance2, V::add(V::mul(dx, dx), V::mul(dy, dy))) & ~done;
+				if(periodic){// cycle detected, these points stay at max_iterations
+					for(int l = 0; l < count; l++){
+						if(periodic & (1<<l))
+							out[l] = params.maxIterations;
+					}
+					local_stats.periodicPoints += __builtin_popcount(periodic);
+					done |= periodic;
+					if(done == all_lanes){
+						break;
+					}
+				}
+				if(i == check){
+					saved_x = zx;
+					saved_y = zy;
+					check *= 2;
+				}
+			}
+		}
+		for(int l = 0; l < count; l++){
+			if(!(done & (1<<l))){
+				out[l] = params.maxIterations;
+			}
+		}
+	}
+	if(stats){
+		stats->add(local_stats);
+	}
+}
+
+// Pixel streaming: every lane works on its own point, as soon as a lane escapes (or reaches
+// max_iterations) its result is written and the lane is refilled with the next pending point.
+// Refilling needs a round trip of the lane state through memory, so it is done once a quarter
+// of the lanes is idle. Vectors only run partially empty once there are no more points left.
+template<class V>
+void simdKernelRefill(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	typedef typename V::Real Real;
+	const int refill_threshold = V::WIDTH >= 4 ? V::WIDTH/4 : 1;
+	const Real four = V::set1(4.0);
+	const bool interior_check = params.interiorCheck && !params.julia;
+	const bool periodicity_check = params.periodicityTolerance > 0;
+	const Real tolerance2 = V::set1(params.periodicityTolerance*params.periodicityTolerance);
+	// lane state, only written back to memory when lanes are refilled
+	double lane_zx[V::WIDTH];
+	double lane_zy[V::WIDTH];
+	double lane_cx[V::WIDTH];
+	double lane_cy[V::WIDTH];
+	double lane_saved_x[V::WIDTH];// orbit point saved by the periodicity check
+	double lane_saved_y[V::WIDTH];
+	int64_t lane_check[V::WIDTH];// iteration of the lane's point at which saved is moved
+	int lane_point[V::WIDTH];// index of the point in lane
+	int64_t lane_start[V::WIDTH];// step at which the point was loaded
+	for(int l = 0; l < V::WIDTH; l++){
+		lane_zx[l] = 0; lane_zy[l] = 0;
+		lane_cx[l] = 0; lane_cy[l] = 0;
+		lane_saved_x[l] = 0; lane_saved_y[l] = 0;
+		lane_check[l] = 1;
+		lane_point[l] = -1;
+		lane_start[l] = 0;
+	}
+	Real zx = V::set1(0.0);
+	Real zy = V::set1(0.0);
+	Real cx = V::set1(0.0);
+	Real cy = V::set1(0.0);
+	Real saved_x = V::set1(0.0);
+	Real saved_y = V::set1(0.0);
+	int64_t save_deadline = INT64_MAX;// earliest step at which a lane moves its saved point
+	int active = 0;// lanes holding a point
+	int next = 0;// next point to be loaded
+	int64_t step = 0;
+	int64_t deadline = 0;// earliest step at which an active lane reaches max_iterations
+	MandelKernelStats local_stats;
+	while(true){
+		// loading pending points into idle lanes
+		if(next < n && V::WIDTH-__builtin_popcount(active) >= refill_threshold){
+			V::store(lane_zx, zx); V::store(lane_zy, zy);
+			V::store(lane_cx, cx); V::store(lane_cy, cy);
+			V::store(lane_saved_x, saved_x); V::store(lane_saved_y, saved_y);
+			for(int l = 0; l < V::WIDTH && next < n; l++){
+				if(active & (1<<l))
+					continue;
+				// interior points never occupy a lane
+				while(interior_check && next < n && isInCardioidOrBulb(x[next], y[next])){
+					iterations[next++] = params.maxIterations;
+					local_stats.interiorPoints++;
+				}
+				if(next >= n)
+					break;
+				if(params.julia){
+					lane_zx[l] = x[next]; lane_zy[l] = y[next];
+					lane_cx[l] = params.juliaC[0]; lane_cy[l] = params.juliaC[1];
+				}
+				else{
+					lane_zx[l] = 0; lane_zy[l] = 0;
+					lane_cx[l] = x[next]; lane_cy[l] = y[next];
+				}
+				lane_saved_x[l] = lane_zx[l]; lane_saved_y[l] = lane_zy[l];
+				lane_check[l] = 1;
+				lane_point[l] = next++;
+				lane_start[l] = step;
+				active |= 1<<l;
+			}
+			zx = V::load(lane_zx); zy = V::load(lane_zy);
+			cx = V::load(lane_cx); cy = V::load(lane_cy);
+			saved_x = V::load(lane_saved_x); saved_y = V::load(lane_saved_y);
+			if(step+1 < save_deadline)// new points move their saved point after the first iteration
+				save_deadline = step+1;
+			deadline = step + params.maxIterations;
+			for(int l = 0; l < V::WIDTH; l++){
+				if((active & (1<<l)) && lane_start[l]+params.maxIterations < deadline)
+					deadline = lane_start[l]+params.maxIterations;
+			}
+		}
+		Real zx2 = V::mul(zx, zx);
+		Real zy2 = V::mul(zy, zy);
+		Real len = V::add(zx2, zy2);
+		int escaped = (params.julia ? V::cmpge(len, four) : V::cmpgt(len, four)) & active;
+		if(step == deadline){// points reaching max_iterations did not escape
+			deadline = step + params.maxIterations;
+			for(int l = 0; l < V::WIDTH; l++){
+				if(!(active & (1<<l)))
+					continue;
+				if(step-lane_start[l] == params.maxIterations){
+					iterations[lane_point[l]] = params.maxIterations;
+					active &= ~(1<<l);
+					escaped &= ~(1<<l);
+				}
+				else if(lane_start[l]+params.maxIterations < deadline){
+					deadline = lane_start[l]+params.maxIterations;
+				}
+			}
+		}
+		if(escaped){
+			for(int l = 0; l < V::WIDTH; l++){
+				if(escaped & (1<<l))
+					iterations[lane_point[l]] = static_cast<int>(step-lane_start[l]);
+			}
+			active &= ~escaped;
+		}
+		// refilled lanes have to be checked before their first iteration
+		if(next < n && V::WIDTH-__builtin_popcount(active) >= refill_threshold)
+			continue;
+		if(!active)
+			break;
+		local_stats.laneSteps += V::WIDTH;
+		local_stats.activeLaneSteps += __builtin_popcount(active);
+		Real zxy = V::mul(zx, zy);
+		zx = V::add(V::sub(zx2, zy2), cx);
+		zy = V::add(V::add(zxy, zxy), cy);
+		if(periodicity_check){
+			Real dx = V::sub(zx, saved_x);
+			Real dy = V::sub(zy, saved_y);
+			int periodic = V::cmpgt(tolerance2, V::add(V::mul(dx, dx), V::mul(dy, dy))) & active;
+			if(periodic){// cycle detected, these points stay at max_iterations
+				for(int l = 0; l < V::WIDTH; l++){
+					if(periodic & (1<<l))
+						iterations[lane_point[l]] = params.maxIterations;
+				}
+				local_stats.periodicPoints += __builtin_popcount(periodic);
+				active &= ~periodic;
+			}
+			if(step == save_deadline){// lanes whose iteration (step-start) reached their check
+				V::store(lane_zx, zx); V::store(lane_zy, zy);
+				V::store(lane_saved_x, saved_x); V::store(lane_saved_y, saved_y);
+				save_deadline = INT64_MAX;
+				for(int l = 0; l < V::WIDTH; l++){
+					if(!(active & (1<<l)))
+						continue;
+					if(step-lane_start[l] == lane_check[l]){
+						lane_saved_x[l] = lane_zx[l];
+						lane_saved_y[l] = lane_zy[l];
+						lane_check[l] *= 2;
+					}
+					if(lane_start[l]+lane_check[l] < save_deadline)
+						save_deadline = lane_start[l]+lane_check[l];
+				}
+				saved_x = V::load(lane_saved_x); saved_y = V::load(lane_saved_y);
+			}
+		}
+		step++;
+	}
+	if(stats){
+		stats->add(local_stats);
+	}
+}
+
+template<class V>
+void runSimdKernel(const MandelKernelParams & params, const double * x, const double * y, int n, int * iterations, MandelKernelStats * stats)
+{
+	if(params.laneRefill){
+		simdKernelRefill<V>(params, x, y, n, iterations, stats);
+	}
+	else{
+		simdKernelMasked<V>(params, x, y, n, iterations, stats);
+	}
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "mandel_escape_data.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+void initMandelEscapeHeader(MandelEscapeHeader & header)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MANDEL_ESCAPE_MAGIC, sizeof(header.magic));
+	header.version = MANDEL_ESCAPE_VERSION;
+	header.headerSize = MANDEL_ESCAPE_HEADER_SIZE;
+}
+
+int saveMandelEscapeData(const char * path, const MandelEscapeHeader & header, const MandelEscapePixel * pixels)
+{
+	FILE * f = fopen(path, "wb");
+	if(f == NULL){
+		printf("Failed to open '%s' for writing!\n", path);
+		return 1;
+	}
+	size_t num_pixels = static_cast<size_t>(header.width)*header.height;
+	bool error = fwrite(&header, sizeof(header), 1, f) != 1 ||
+		fwrite(pixels, sizeof(MandelEscapePixel), num_pixels, f) != num_pixels;
+	if(fclose(f) != 0 || error){
+		printf("Failed to write escape data '%s'!\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+MandelEscapeFile::MandelEscapeFile()
+{
+	_data = NULL;
+	_size = 0;
+}
+
+int MandelEscapeFile::open(const char * path)
+{
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0){
+		printf("Failed to open '%s'!\n", path);
+		return 1;
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(MandelEscapeHeader)){
+		printf("'%s' is not an escape data file!\n", path);
+		::close(fd);
+		return 1;
+	}
+	_size = static_cast<size_t>(st.st_size);
+	void * data = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);// the mapping keeps the file open
+	if(data == MAP_FAILED){
+		printf("Failed to map '%s'!\n", path);
+		return 1;
+	}
+	_data = data;
+	const MandelEscapeHeader * h = getHeader();
+	if(memcmp(h->magic, MANDEL_ESCAPE_MAGIC, sizeof(h->magic)) != 0 || h->version != MANDEL_ESCAPE_VERSION ||
+		h->headerSize < sizeof(MandelEscapeHeader)){
+		printf("'%s' is not an escape data file of version %d!\n", path, MANDEL_ESCAPE_VERSION);
+		close();
+		return 1;
+	}
+	if(_size < h->headerSize + static_cast<size_t>(h->width)*h->height*sizeof(MandelEscapePixel)){
+		printf("Escape data file '%s' is truncated!\n", path);
+		close();
+		return 1;
+	}
+	return 0;
+}
+
+void MandelEscapeFile::close()
+{
+	if(_data != NULL){
+		munmap(_data, _size);
+		_data = NULL;
+		_size = 0;
+	}
+}
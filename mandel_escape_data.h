@@ -0,0 +1,71 @@
+#ifndef MANDEL_ESCAPE_DATA_H
+#define MANDEL_ESCAPE_DATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Escape data file (.mesc): the per-pixel result of the escape-time loop before coloring, so a view can
+// be colored again or analysed without computing it. All values are little endian.
+//
+//   offset 0:                          MandelEscapeHeader (MANDEL_ESCAPE_HEADER_SIZE bytes)
+//   offset header.headerSize:          width*height MandelEscapePixel, rows bottom-up like the .bmp files
+//
+// The header is one page, so the pixels of a memory mapped file can be used in place.
+
+#define MANDEL_ESCAPE_MAGIC "MANDESC1"
+#define MANDEL_ESCAPE_VERSION 1
+#define MANDEL_ESCAPE_HEADER_SIZE 4096
+
+// MandelEscapePixel::flags
+#define MANDEL_ESCAPE_INTERIOR 1// did not escape within maxIterations (or stopped by the interior/periodicity checks)
+
+struct MandelEscapePixel{
+	// smooth iteration count n + 1 - log2(log|z|), maxIterations for interior points
+	float iterations;
+	// |z|^2 after the last iteration
+	float norm;
+	uint32_t flags;
+};
+
+struct MandelEscapeHeader{
+	char magic[8];// MANDEL_ESCAPE_MAGIC without terminating zero
+	uint32_t version;
+	uint32_t headerSize;// offset of the pixels
+	uint32_t width;
+	uint32_t height;
+	uint32_t maxIterations;
+	uint32_t julia;// 1: julia set with juliaC
+	double zoom;
+	double position[2];// view center (all digits are in location)
+	double juliaC[2];
+	// location file contents (as read by --location), zero terminated
+	char location[MANDEL_ESCAPE_HEADER_SIZE - 72];
+};
+
+static_assert(sizeof(MandelEscapePixel) == 12, "MandelEscapePixel must not be padded");
+static_assert(sizeof(MandelEscapeHeader) == MANDEL_ESCAPE_HEADER_SIZE, "MandelEscapeHeader must be one page");
+
+// sets magic, version and header size, everything else to zero
+void initMandelEscapeHeader(MandelEscapeHeader & header);
+
+// writes header and header.width*header.height pixels, returns 0 on success
+int saveMandelEscapeData(const char * path, const MandelEscapeHeader & header, const MandelEscapePixel * pixels);
+
+// Read-only memory mapping of an escape data file, pixels are read straight from the page cache.
+class MandelEscapeFile{
+public:
+	MandelEscapeFile();
+	~MandelEscapeFile(){close();}
+	// maps the file and checks the header, returns 0 on success
+	int open(const char * path);
+	void close();
+	const MandelEscapeHeader * getHeader(){return static_cast<const MandelEscapeHeader*>(_data);}
+	const MandelEscapePixel * getPixels(){
+		return reinterpret_cast<const MandelEscapePixel*>(static_cast<const char*>(_data) + getHeader()->headerSize);
+	}
+private:
+	void * _data;
+	size_t _size;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "mandel_exp_map.h"
+#include <math.h>
+
+#define MANDEL_EXP_MAP_PI 3.14159265358979323846
+
+MandelExpMap::MandelExpMap()
+{
+	_center[0] = 0;
+	_center[1] = 0;
+	_logTop = 0;
+	_numAngles = 0;
+	_rowsPerOctave = 0;
+	_numRows = 0;
+	_w = 0;
+	_h = 0;
+	_numStripsRendered = 0;
+	_renderCPU = NULL;
+	_renderStrip = 0;
+	_renderRow = 0;
+	_pixelScale = 1;
+	_renderTarget = NULL;
+}
+
+void MandelExpMap::init(double center_x, double center_y, double r_top, double r_bottom, int w, int h)
+{
+	_center[0] = center_x;
+	_center[1] = center_y;
+	_w = w;
+	_h = h;
+	// one sample per pixel on the circle through the frame corners
+	double half_diagonal = 0.5*sqrt(static_cast<double>(w)*w + static_cast<double>(h)*h);
+	_numAngles = static_cast<int>(ceil(2*MANDEL_EXP_MAP_PI*half_diagonal));
+	_rowsPerOctave = static_cast<int>(ceil(log(2.0)*_numAngles/(2*MANDEL_EXP_MAP_PI)));
+	_logTop = log(r_top);
+	_numRows = static_cast<int>(ceil((_logTop - log(r_bottom))/log(2.0)*_rowsPerOctave)) + 2;
+	_strips.clear();
+	_strips.resize((_numRows + _rowsPerOctave-1)/_rowsPerOctave);
+	_rows.assign(_strips.size()*_rowsPerOctave, NULL);
+	_numStripsRendered = 0;
+	_pixels.clear();
+}
+
+void MandelExpMap::getRows(double r_in, double r_out, int & first, int & last)
+{
+	double rows_per_log = _rowsPerOctave/log(2.0);
+	first = static_cast<int>(floor((_logTop - log(r_out))*rows_per_log));
+	last = static_cast<int>(ceil((_logTop - log(r_in))*rows_per_log)) + 1;
+	if(first < 0) first = 0;
+	if(last > _numRows-1) last = _numRows-1;
+	if(first > last) first = last;
+}
+
+void MandelExpMap::prepareFrame(const double * transform, MandelCPU & cpu, MandelTileScheduler * scheduler)
+{
+	double pixel_x = 2*fabs(transform[0])/_w;
+	double pixel_y = 2*fabs(transform[4])/_h;
+	int first, last;
+	getRows(0.5*(pixel_x < pixel_y ? pixel_x : pixel_y), sqrt(transform[0]*transform[0] + transform[4]*transform[4]), first, last);
+	int first_strip = first/_rowsPerOctave;
+	int last_strip = last/_rowsPerOctave;
+	for(int k = 0; k < static_cast<int>(_strips.size()); k++){
+		if(k < first_strip || k > last_strip){
+			std::vector<uint32_t>().swap(_strips[k]);
+			for(int row = 0; row < _rowsPerOctave; row++){
+				_rows[k*_rowsPerOctave + row] = NULL;
+			}
+		}
+		else if(_strips[k].empty()){
+			_strips[k].resize(static_cast<size_t>(_rowsPerOctave)*_numAngles);
+			_renderCPU = &cpu;
+			_renderStrip = k;
+			if(scheduler == NULL){
+				MandelTile t = {0, 0, _numAngles, _rowsPerOctave};
+				stripTile(t, 0, this);
+			}
+			else{
+				scheduler->run(_numAngles, _rowsPerOctave, MANDEL_CPU_TILE_SIZE, stripTile, this);
+			}
+			for(int row = 0; row < _rowsPerOctave; row++){
+				_rows[k*_rowsPerOctave + row] = &_strips[k][static_cast<size_t>(row)*_numAngles];
+			}
+			_numStripsRendered++;
+		}
+	}
+}
+
+void MandelExpMap::stripTile(const MandelTile & tile, int /*worker*/, void * user)
+{
+	MandelExpMap * map = static_cast<MandelExpMap*>(user);
+	std::vector<double> px(tile.w);
+	std::vector<double> py(tile.w);
+	for(int row = tile.y; row < tile.y+tile.h; row++){
+		int g = map->_renderStrip*map->_rowsPerOctave + row;
+		double r = exp(map->_logTop - g*log(2.0)/map->_rowsPerOctave);
+		for(int i = 0; i < tile.w; i++){
+			double a = 2*MANDEL_EXP_MAP_PI*(tile.x + i)/map->_numAngles;
+			px[i] = map->_center[0] + r*cos(a);
+			py[i] = map->_center[1] + r*sin(a);
+		}
+		uint32_t * out = &map->_strips[map->_renderStrip][static_cast<size_t>(row)*map->_numAngles + tile.x];
+		map->_renderCPU->renderPoints(&px[0], &py[0], tile.w, out, NULL);
+	}
+}
+
+// a + (b-a)*f/256 for all four channels, two at once
+static inline uint32_t lerpColor(uint32_t a, uint32_t b, int f)
+{
+	uint32_t rb = (((a&0xFF00FF)*(256-f) + (b&0xFF00FF)*f)>>8)&0xFF00FF;
+	uint32_t ga = ((((a>>8)&0xFF00FF)*(256-f) + ((b>>8)&0xFF00FF)*f))&0xFF00FF00;
+	return rb | ga;
+}
+
+void MandelExpMap::renderFrame(const double * transform, uint32_t * rgba, MandelTileScheduler * scheduler)
+{
+	double rows_per_log = _rowsPerOctave/log(2.0);
+	if(_pixels.empty()){
+		_pixelScale = transform[4];
+		_pixels.resize(static_cast<size_t>(_w)*_h);
+		// the center pixel of odd sized frames is at the map center, whose row is at infinity,
+		// radii are clamped to half a pixel as the rows prepareFrame renders
+		double pixel_x = 2*fabs(transform[0])/_w;
+		double pixel_y = 2*fabs(transform[4])/_h;
+		double min_r = 0.5*(pixel_x < pixel_y ? pixel_x : pixel_y);
+		for(int y = 0; y < _h; y++){
+			for(int x = 0; x < _w; x++){
+				// offset of the pixel center to the map center, as MandelCPU::pixelToWorld
+				double p[2] = {2*(x + 0.5)/_w - 1, 2*(y + 0.5)/_h - 1};
+				double dx = transform[0]*p[0] + transform[3]*p[1];
+				double dy = transform[1]*p[0] + transform[4]*p[1];
+				double column = atan2(dy, dx)/(2*MANDEL_EXP_MAP_PI)*_numAngles;
+				if(column < 0)
+					column += _numAngles;
+				PixelSample & s = _pixels[static_cast<size_t>(y)*_w + x];
+				double r2 = dx*dx + dy*dy;
+				if(r2 < min_r*min_r)
+					r2 = min_r*min_r;
+				s.row = static_cast<float>((log(_pixelScale) - 0.5*log(r2))*rows_per_log);
+				s.column0 = static_cast<int>(floor(column));
+				s.columnWeight = static_cast<float>(column - s.column0);
+				s.column0 %= _numAngles;
+				s.column1 = (s.column0 + 1)%_numAngles;
+			}
+		}
+	}
+	_renderRow = (_logTop - log(transform[4]))*rows_per_log;
+	_renderTarget = rgba;
+	if(scheduler == NULL){
+		MandelTile t = {0, 0, _w, _h};
+		frameTile(t, 0, this);
+	}
+	else{
+		scheduler->run(_w, _h, MANDEL_CPU_TILE_SIZE, frameTile, this);
+	}
+}
+
+void MandelExpMap::frameTile(const MandelTile & tile, int /*worker*/, void * user)
+{
+	MandelExpMap * map = static_cast<MandelExpMap*>(user);
+	for(int y = tile.y; y < tile.y+tile.h; y++){
+		for(int x = tile.x; x < tile.x+tile.w; x++){
+			const PixelSample & s = map->_pixels[static_cast<size_t>(y)*map->_w + x];
+			// bilinear filtering between the two rows and columns around the pixel
+			double row = map->_renderRow + s.row;
+			int g = static_cast<int>(floor(row));
+			if(g < 0) g = 0;
+			if(g > map->_numRows-2) g = map->_numRows-2;
+			double wg = row - g;
+			if(wg < 0) wg = 0;
+			if(wg > 1) wg = 1;
+			const uint32_t * row0 = map->_rows[g];
+			const uint32_t * row1 = map->_rows[g+1];
+			// rows outside of the frame radii are not rendered
+			if(row0 == NULL || row1 == NULL){
+				if(row0 == NULL && row1 == NULL){
+					map->_renderTarget[static_cast<size_t>(y)*map->_w + x] = 0xFF000000;
+					continue;
+				}
+				if(row0 == NULL)
+					row0 = row1;
+				else
+					row1 = row0;
+			}
+			int fi = static_cast<int>(s.columnWeight*256);
+			uint32_t top = lerpColor(row0[s.column0], row0[s.column1], fi);
+			uint32_t bottom = lerpColor(row1[s.column0], row1[s.column1], fi);
+			uint32_t pixel = lerpColor(top, bottom, static_cast<int>(wg*256));
+			map->_renderTarget[static_cast<size_t>(y)*map->_w + x] = pixel;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef MANDEL_EXP_MAP_H
+#define MANDEL_EXP_MAP_H
+
+#include "mandel_cpu.h"
+#include "mandel_tile_scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+// Exponential map (log-polar image) around a fixed center for zoom videos. Column i is the angle
+// 2*pi*i/num_angles, row g the radius r_top*2^(-g/rows_per_octave), so every frame of a zoom into the
+// center is a part of the map and can be resampled from it instead of being computed.
+// The spacing of rows and columns is the same (conformal), one sample is as large as a frame pixel
+// in the frame corners and smaller everywhere else. Rows are rendered in strips of one octave
+// when a frame needs them, strips no frame needs anymore are freed.
+class MandelExpMap{
+public:
+	MandelExpMap();
+	// radii from r_top down to r_bottom (fractal coordinates) for frames of w x h pixels
+	void init(double center_x, double center_y, double r_top, double r_bottom, int w, int h);
+	// renders the missing strips of the frame with the given view transform (as MandelCPU::setTransform,
+	// centered at the map center) and frees the strips outside of it (zoom videos never go back)
+	void prepareFrame(const double * transform, MandelCPU & cpu, MandelTileScheduler * scheduler);
+	// resamples the frame (bottom row first) from the strips, prepareFrame must be called first.
+	// Frames may only differ in scale, the map position of every pixel is computed once for the first frame.
+	void renderFrame(const double * transform, uint32_t * rgba, MandelTileScheduler * scheduler);
+	int getNumAngles(){return _numAngles;}
+	int getRowsPerOctave(){return _rowsPerOctave;}
+	// strips rendered so far
+	int getNumStripsRendered(){return _numStripsRendered;}
+private:
+	// rows of the map covering radii [r_in, r_out]
+	void getRows(double r_in, double r_out, int & first, int & last);
+	static void stripTile(const MandelTile & tile, int worker, void * user);
+	static void frameTile(const MandelTile & tile, int worker, void * user);
+
+	double _center[2];
+	double _logTop;// ln(r_top)
+	int _numAngles;
+	int _rowsPerOctave;
+	int _numRows;
+	int _w;
+	int _h;
+	std::vector<std::vector<uint32_t> > _strips;// _rowsPerOctave*_numAngles each, empty: not rendered
+	std::vector<const uint32_t*> _rows;// into _strips, NULL if the strip is not rendered
+	int _numStripsRendered;
+	// map position of a frame pixel, rows relative to the row of the frame scale
+	struct PixelSample{
+		float row;
+		float columnWeight;// of column1
+		int column0;
+		int column1;
+	};
+	std::vector<PixelSample> _pixels;
+	double _pixelScale;// transform[4] the rows of _pixels are relative to
+	// state of the strip or frame being rendered by the tile functions
+	MandelCPU * _renderCPU;
+	int _renderStrip;
+	double _renderRow;// map row of the frame scale
+	uint32_t * _renderTarget;
+};
+
+#endif
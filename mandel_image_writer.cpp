@@ -0,0 +1,187 @@
+#include "mandel_image_writer.h"
+#include <string.h>
+#include <utility>
+
+static void putU16(uint8_t * p, uint32_t v)
+{
+	p[0] = v&0xFF;
+	p[1] = (v>>8)&0xFF;
+}
+
+static void putU32(uint8_t * p, uint32_t v)
+{
+	putU16(p, v&0xFFFF);
+	putU16(p+2, v>>16);
+}
+
+MandelBMPWriter::MandelBMPWriter()
+{
+	_file = NULL;
+	_w = 0;
+	_h = 0;
+	_rowsWritten = 0;
+	_error = false;
+}
+
+int MandelBMPWriter::open(const char * path, int w, int h)
+{
+	close();
+	_file = fopen(path, "wb");
+	if(_file == NULL){
+		printf("Failed to open '%s' for writing!\n", path);
+		return 1;
+	}
+	_w = w;
+	_h = h;
+	_rowsWritten = 0;
+	_error = false;
+	_row.assign((w*3 + 3)&~3, 0);
+	uint64_t image_size = static_cast<uint64_t>(_row.size())*h;
+	uint64_t file_size = 54 + image_size;
+	// size fields are 32 bit, readers take the size from width and height if they are 0
+	if(file_size > 0xFFFFFFFFu){
+		file_size = 0;
+		image_size = 0;
+	}
+	uint8_t header[54];
+	memset(header, 0, sizeof(header));
+	// BITMAPFILEHEADER
+	header[0] = 'B';
+	header[1] = 'M';
+	putU32(header + 2, static_cast<uint32_t>(file_size));
+	putU32(header + 10, 54);// pixel data offset
+	// BITMAPINFOHEADER, positive height: bottom row first
+	putU32(header + 14, 40);
+	putU32(header + 18, static_cast<uint32_t>(w));
+	putU32(header + 22, static_cast<uint32_t>(h));
+	putU16(header + 26, 1);// planes
+	putU16(header + 28, 24);// bits per pixel
+	putU32(header + 34, static_cast<uint32_t>(image_size));
+	putU32(header + 38, 2835);// 72 dpi
+	putU32(header + 42, 2835);
+	if(fwrite(header, sizeof(header), 1, _file) != 1){
+		_error = true;
+	}
+	return _error ? 1 : 0;
+}
+
+int MandelBMPWriter::writeRows(const uint32_t * rgba, int num_rows)
+{
+	if(_file == NULL || _error)
+		return 1;
+	for(int r = 0; r < num_rows; r++){
+		const uint32_t * src = rgba + static_cast<size_t>(r)*_w;
+		for(int x = 0; x < _w; x++){
+			uint32_t p = src[x];
+			_row[x*3 + 0] = (p>>16)&0xFF;// blue
+			_row[x*3 + 1] = (p>>8)&0xFF;
+			_row[x*3 + 2] = p&0xFF;
+		}
+		if(fwrite(&_row[0], _row.size(), 1, _file) != 1){
+			_error = true;
+			return 1;
+		}
+	}
+	_rowsWritten += num_rows;
+	return 0;
+}
+
+int MandelBMPWriter::close()
+{
+	if(_file == NULL)
+		return 0;
+	if(fclose(_file) != 0 || _rowsWritten != _h){
+		_error = true;
+	}
+	_file = NULL;
+	return _error ? 1 : 0;
+}
+
+int saveMandelBMP(const char * path, const uint32_t * rgba, int w, int h)
+{
+	MandelBMPWriter writer;
+	if(writer.open(path, w, h) || writer.writeRows(rgba, h) || writer.close()){
+		printf("Failed to write image '%s'!\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+MandelImageWriter::MandelImageWriter()
+{
+	_busy = false;
+	_quit = false;
+	_thread = std::thread(&MandelImageWriter::writerLoop, this);
+}
+
+MandelImageWriter::~MandelImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_jobCondition.notify_all();
+	_thread.join();
+}
+
+void MandelImageWriter::write(const char * path, std::vector<uint32_t> & rgba, int w, int h, const char * text_path, const char * text)
+{
+	Job job;
+	job.path = path;
+	job.rgba.swap(rgba);
+	job.w = w;
+	job.h = h;
+	if(text_path != NULL && text != NULL){
+		job.textPath = text_path;
+		job.text = text;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_jobCondition.notify_one();
+}
+
+void MandelImageWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_jobs.empty() || _busy){
+		_doneCondition.wait(lock);
+	}
+}
+
+void MandelImageWriter::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true){
+		// queued images are still written when quitting
+		while(_jobs.empty() && !_quit){
+			_jobCondition.wait(lock);
+		}
+		if(_jobs.empty()){
+			break;
+		}
+		Job job = std::move(_jobs.front());
+		_jobs.pop_front();
+		_busy = true;
+		lock.unlock();
+
+		if(!saveMandelBMP(job.path.c_str(), &job.rgba[0], job.w, job.h)){
+			printf("Saved image to '%s'.\n", job.path.c_str());
+		}
+		if(!job.textPath.empty()){
+			FILE * f = fopen(job.textPath.c_str(), "w");
+			if(f == NULL){
+				printf("Failed to save '%s'!\n", job.textPath.c_str());
+			}
+			else{
+				fputs(job.text.c_str(), f);
+				fclose(f);
+			}
+		}
+
+		lock.lock();
+		_busy = false;
+		_doneCondition.notify_all();
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef MANDEL_IMAGE_WRITER_H
+#define MANDEL_IMAGE_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Writes a 24 bit .bmp file row by row. Rows are RGBA (red in the lowest byte) with the bottom row first,
+// just like glReadPixels and MandelCPU::render, which is also the row order of .bmp files.
+class MandelBMPWriter{
+public:
+	MandelBMPWriter();
+	~MandelBMPWriter(){close();}
+	// writes the header, returns 0 on success
+	int open(const char * path, int w, int h);
+	// appends num_rows rows of w pixels, returns 0 on success
+	int writeRows(const uint32_t * rgba, int num_rows);
+	// returns 0 if all rows were written
+	int close();
+private:
+	FILE * _file;
+	int _w;
+	int _h;
+	int _rowsWritten;
+	bool _error;
+	std::vector<uint8_t> _row;// bgr, padded to 4 bytes
+};
+
+// writes a whole image with MandelBMPWriter, returns 0 on success
+int saveMandelBMP(const char * path, const uint32_t * rgba, int w, int h);
+
+// Writes images (plus an optional text file, e.g. the location) on a background thread,
+// so the caller never waits for encoding or the disk.
+class MandelImageWriter{
+public:
+	MandelImageWriter();
+	// writes all queued images before returning
+	~MandelImageWriter();
+	// queues rgba (w x h, bottom row first) to be saved as .bmp at path, the pixels are taken out of rgba,
+	// text is written to text_path if it is not NULL
+	void write(const char * path, std::vector<uint32_t> & rgba, int w, int h, const char * text_path = NULL, const char * text = NULL);
+	// waits until all queued images are written
+	void flush();
+private:
+	struct Job{
+		std::string path;
+		std::vector<uint32_t> rgba;
+		int w, h;
+		std::string textPath;
+		std::string text;
+	};
+	void writerLoop();
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _jobCondition;
+	std::condition_variable _doneCondition;
+	std::deque<Job> _jobs;
+	bool _busy;// a job was taken from _jobs and is being written
+	bool _quit;
+};
+
+#endif
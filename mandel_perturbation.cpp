@@ -0,0 +1,141 @@
+#include "mandel_perturbation.h"
+#include <math.h>
+
+void computeReferenceOrbit(MandelReferenceOrbit & orbit, const MandelBigFixed & x, const MandelBigFixed & y,
+							bool julia, const double * julia_c, int max_iterations)
+{
+	orbit.x = x;
+	orbit.y = y;
+	orbit.zx.clear();
+	orbit.zy.clear();
+	orbit.glitchLimit.clear();
+	int limbs = x.getLimbs();
+	MandelBigFixed cx, cy, zx, zy;
+	if(julia){
+		cx.set(julia_c[0], limbs);
+		cy.set(julia_c[1], limbs);
+		zx = x;
+		zy = y;
+	}
+	else{
+		cx = x;
+		cy = y;
+		zx.setZero(limbs);
+		zy.setZero(limbs);
+	}
+	MandelBigFixed zx2, zy2, zxy;
+	for(int i = 0; i < max_iterations; i++){
+		double dzx = zx.toDouble();
+		double dzy = zy.toDouble();
+		double len = dzx*dzx + dzy*dzy;
+		orbit.zx.push_back(dzx);
+		orbit.zy.push_back(dzy);
+		orbit.glitchLimit.push_back(MANDEL_GLITCH_TOLERANCE*len);
+		// the escaping value is still needed by pixels that escape at the same iteration
+		if(len > 4.0){
+			break;
+		}
+		MandelBigFixed::sqr(zx, zx2);
+		MandelBigFixed::sqr(zy, zy2);
+		MandelBigFixed::mul(zx, zy, zxy);
+		MandelBigFixed::sub(zx2, zy2, zx);
+		MandelBigFixed::add(zx, cx, zx);
+		MandelBigFixed::twice(zxy, zy);
+		MandelBigFixed::add(zy, cy, zy);
+	}
+}
+
+void computeSeriesApproximation(MandelSeriesApproximation & series, const MandelReferenceOrbit & orbit,
+								bool julia, double radius, double spacing, double tolerance, int max_iterations)
+{
+	double a[2] = {julia ? 1.0 : 0.0, 0};
+	double b[2] = {0, 0};
+	double c[2] = {0, 0};
+	double r3 = radius*radius*radius;
+	series = MandelSeriesApproximation();
+	series.a[0] = a[0];
+	// the last orbit value may already be escaped, pixels have to check it themselves
+	int last = orbit.getLength()-1;
+	if(last > max_iterations) last = max_iterations;
+	// pixels only check escape and glitches from iteration skip on, so no offset may reach them before
+	double glitch_factor = sqrt(MANDEL_GLITCH_TOLERANCE);
+	for(int n = 0; n+1 < last; n++){
+		double zx = orbit.zx[n];
+		double zy = orbit.zy[n];
+		// bound of |d_n| over the view
+		double d = (hypot(a[0], a[1]) + (hypot(b[0], b[1]) + hypot(c[0], c[1])*radius)*radius)*radius;
+		double z = hypot(zx, zy);
+		if(!(z + d < 2.0) || z - d < glitch_factor*z){// also stops on overflow
+			break;
+		}
+		double na[2], nb[2], nc[2];
+		na[0] = 2*(zx*a[0] - zy*a[1]) + (julia ? 0.0 : 1.0);
+		na[1] = 2*(zx*a[1] + zy*a[0]);
+		nb[0] = 2*(zx*b[0] - zy*b[1]) + (a[0]*a[0] - a[1]*a[1]);
+		nb[1] = 2*(zx*b[1] + zy*b[0]) + 2*a[0]*a[1];
+		nc[0] = 2*(zx*c[0] - zy*c[1]) + 2*(a[0]*b[0] - a[1]*b[1]);
+		nc[1] = 2*(zx*c[1] + zy*c[0]) + 2*(a[0]*b[1] + a[1]*b[0]);
+		// truncation error compared to the pixel spacing at iteration n+1
+		double error = hypot(nc[0], nc[1])*r3;
+		double pixel = hypot(na[0], na[1])*spacing;
+		if(!(error <= tolerance*pixel)){// also stops on overflow
+			break;
+		}
+		a[0] = na[0]; a[1] = na[1];
+		b[0] = nb[0]; b[1] = nb[1];
+		c[0] = nc[0]; c[1] = nc[1];
+		series.skip = n+1;
+		series.a[0] = a[0]; series.a[1] = a[1];
+		series.b[0] = b[0]; series.b[1] = b[1];
+		series.c[0] = c[0]; series.c[1] = c[1];
+	}
+}
+
+int perturbationEscapeTime(const MandelReferenceOrbit & orbit, double dx, double dy, bool julia, int max_iterations,
+							const MandelSeriesApproximation * series)
+{
+	const double * ref_x = &orbit.zx[0];
+	const double * ref_y = &orbit.zy[0];
+	const double * glitch_limit = &orbit.glitchLimit[0];
+	int length = orbit.getLength();
+	double ddx, ddy, dcx, dcy;
+	if(julia){
+		ddx = dx; ddy = dy;
+		dcx = 0; dcy = 0;
+	}
+	else{
+		ddx = 0; ddy = 0;
+		dcx = dx; dcy = dy;
+	}
+	int start = 0;
+	if(series && series->skip > 0){
+		// d = ((C*e + B)*e + A)*e
+		double x = series->c[0]*dx - series->c[1]*dy + series->b[0];
+		double y = series->c[0]*dy + series->c[1]*dx + series->b[1];
+		double t = x*dx - y*dy + series->a[0];
+		y = x*dy + y*dx + series->a[1];
+		x = t;
+		ddx = x*dx - y*dy;
+		ddy = x*dy + y*dx;
+		start = series->skip;
+	}
+	for(int i = start; i < max_iterations; i++){
+		if(i >= length){// reference escaped before this pixel
+			return MANDEL_GLITCH;
+		}
+		double zx = ref_x[i] + ddx;
+		double zy = ref_y[i] + ddy;
+		double len = zx*zx + zy*zy;
+		if(julia ? len >= 4.0 : len > 4.0){
+			return i;
+		}
+		if(len < glitch_limit[i]){
+			return MANDEL_GLITCH;
+		}
+		// d' = 2*Z*d + d^2 + dc
+		double x = 2*(ref_x[i]*ddx - ref_y[i]*ddy) + (ddx*ddx - ddy*ddy) + dcx;
+		ddy = 2*(ref_x[i]*ddy + ref_y[i]*ddx) + 2*ddx*ddy + dcy;
+		ddx = x;
+	}
+	return max_iterations;
+}
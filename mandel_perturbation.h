@@ -0,0 +1,64 @@
+#ifndef MANDEL_PERTURBATION_H
+#define MANDEL_PERTURBATION_H
+
+#include "mandel_bigfixed.h"
+#include <stddef.h>
+#include <vector>
+
+// Perturbation theory for deep zooms: one orbit Z_n is computed in high precision at a
+// reference point, every pixel only iterates its (small) difference d_n to that orbit in doubles:
+//   d_{n+1} = 2*Z_n*d_n + d_n^2 + dc
+// Mandelbrot: Z_0 = 0, d_0 = 0, dc = pixel - reference
+// Julia:      Z_0 = reference, d_0 = pixel - reference, dc = 0
+
+// returned by perturbationEscapeTime() if the pixel cannot be computed with the given reference
+#define MANDEL_GLITCH -1
+
+// Pauldelbrot's criterion, pixel is glitched if |Z_n + d_n|^2 < tolerance*|Z_n|^2
+#define MANDEL_GLITCH_TOLERANCE 1e-6
+
+struct MandelReferenceOrbit{
+	// reference point
+	MandelBigFixed x;
+	MandelBigFixed y;
+	// Z_n rounded to double, n = 0..getLength()-1
+	std::vector<double> zx;
+	std::vector<double> zy;
+	// MANDEL_GLITCH_TOLERANCE*|Z_n|^2
+	std::vector<double> glitchLimit;
+	int getLength() const {return static_cast<int>(zx.size());}
+};
+
+// computes the orbit at (x, y) until it escapes or max_iterations is reached
+void computeReferenceOrbit(MandelReferenceOrbit & orbit, const MandelBigFixed & x, const MandelBigFixed & y,
+							bool julia, const double * julia_c, int max_iterations);
+
+// Series approximation: for small offsets e (e = dc for Mandelbrot, e = d_0 for Julia)
+//   d_n ~ A_n*e + B_n*e^2 + C_n*e^3
+// with coefficients that only depend on the reference orbit:
+//   A_{n+1} = 2*Z_n*A_n + 1 (Mandelbrot) or 2*Z_n*A_n (Julia)
+//   B_{n+1} = 2*Z_n*B_n + A_n^2
+//   C_{n+1} = 2*Z_n*C_n + 2*A_n*B_n
+// Pixels start at iteration skip instead of 0.
+struct MandelSeriesApproximation{
+	MandelSeriesApproximation(){skip = 0; a[0] = a[1] = b[0] = b[1] = c[0] = c[1] = 0;}
+	int skip;
+	// coefficients A, B, C at iteration skip (complex)
+	double a[2];
+	double b[2];
+	double c[2];
+};
+
+// computes the coefficients for offsets up to radius, iterations are skipped as long as the
+// truncation error (|C_n|*radius^3) stays below tolerance pixels of the given spacing and no offset
+// can escape or glitch within the skipped iterations
+void computeSeriesApproximation(MandelSeriesApproximation & series, const MandelReferenceOrbit & orbit,
+								bool julia, double radius, double spacing, double tolerance, int max_iterations);
+
+// escape time of the point at offset (dx, dy) from the reference (same loop as in MANDEL_FRAGMENT_SHADER),
+// MANDEL_GLITCH if the pixel was detected as glitched or outlived the reference orbit,
+// with series the first series->skip iterations are replaced by the approximation
+int perturbationEscapeTime(const MandelReferenceOrbit & orbit, double dx, double dy, bool julia, int max_iterations,
+							const MandelSeriesApproximation * series = NULL);
+
+#endif
@@ -1,13 +1,12 @@
 #include "mandel_shader.h"
 
-int MandelShader::compile(bool d)
+GLuint compileShaderProgram(const char * vertex_source, const char * fragment_source, int * error_count)
 {
-	_doublePrecision = d;
 	GLint success = 0;
 	int error = 0;
 	//create and compile vertex shader
 	GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader, 1, &MANDEL_VERTEX_SHADER, 0);
+	glShaderSource(vertex_shader, 1, &vertex_source, 0);
 	glCompileShader(vertex_shader);
 	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
 	if(success == GL_FALSE){
@@ -17,7 +16,7 @@ int MandelShader::compile(bool d)
 
 	//create and compile fragment shader
 	GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader, 1, d ? &MANDEL_FRAGMENT_SHADER_DOUBLE : &MANDEL_FRAGMENT_SHADER, 0);
+	glShaderSource(fragment_shader, 1, &fragment_source, 0);
 	glCompileShader(fragment_shader);
 	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
 	if(success == GL_FALSE){
@@ -26,11 +25,11 @@ int MandelShader::compile(bool d)
 	}
 
 	//create and link program with vs and fs
-	_programID = glCreateProgram();
-	glAttachShader(_programID, vertex_shader);
-	glAttachShader(_programID, fragment_shader);
-	glLinkProgram(_programID);
-	glGetShaderiv(_programID, GL_LINK_STATUS, &success);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	glLinkProgram(program);
+	glGetShaderiv(program, GL_LINK_STATUS, &success);
 	if(success == GL_FALSE){
 		puts("Error during program linking!");
 		error++;	
@@ -55,7 +54,7 @@ int MandelShader::compile(bool d)
 		}
 
 		//Program Error-Log
-		glGetProgramInfoLog(_programID, bufSize, 0, buffer);
+		glGetProgramInfoLog(program, bufSize, 0, buffer);
 		buffer[bufSize-1] = '\0';
 		if(buffer[0] != '\0')//non-empty
 		{
@@ -66,6 +65,21 @@ int MandelShader::compile(bool d)
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
+	*error_count = error;
+	return program;
+}
+
+int MandelShader::compile(MandelShaderPrecision precision)
+{
+	_precision = precision;
+	int error = 0;
+	const char * fragment_shader = MANDEL_FRAGMENT_SHADER;
+	if(precision == MANDEL_SHADER_DOUBLE)
+		fragment_shader = MANDEL_FRAGMENT_SHADER_DOUBLE;
+	else if(precision == MANDEL_SHADER_DOUBLE_FLOAT)
+		fragment_shader = MANDEL_FRAGMENT_SHADER_DOUBLE_FLOAT;
+	_programID = compileShaderProgram(MANDEL_VERTEX_SHADER, fragment_shader, &error);
+
 	// getting locations
 	if(_programID > 0){
 		_vertexLocation = glGetAttribLocation(_programID, "vertex");
@@ -73,11 +87,21 @@ int MandelShader::compile(bool d)
 		_colorMapLocation = glGetUniformLocation(_programID, "color_map");
 		_maxIterationsLocation = glGetUniformLocation(_programID, "max_iterations");
 		_transformLocation = glGetUniformLocation(_programID, "transform");
+		_transformLoLocation = glGetUniformLocation(_programID, "transform_lo");
 		_juliaCLocation = glGetUniformLocation(_programID, "julia_c");
+		_juliaCLoLocation = glGetUniformLocation(_programID, "julia_c_lo");
 		_juliaLocation = glGetUniformLocation(_programID, "julia");
+		_interiorCheckLocation = glGetUniformLocation(_programID, "interior_check");
+		_periodicityToleranceLocation = glGetUniformLocation(_programID, "periodicity_tolerance");
+		_colorOffsetLocation = glGetUniformLocation(_programID, "color_offset");
+		_outputIterationsLocation = glGetUniformLocation(_programID, "output_iterations");
 		_numSamplesLocation = glGetUniformLocation(_programID, "num_samples");
 		_sampleMapLocation = glGetUniformLocation(_programID, "sobol_map");
+		_adaptiveSamplingLocation = glGetUniformLocation(_programID, "adaptive_sampling");
+		_firstPassLocation = glGetUniformLocation(_programID, "first_pass");
+		use();
 		glUniform1i(_colorMapLocation, 0);// default target: 0
+		glUniform1i(_firstPassLocation, MANDEL_IMAGE_TEXTURE_UNIT);
 		setNumSamples(1);
 	}
 	//return number of errors
@@ -98,3 +122,23 @@ void MandelShader::setNumSamples(unsigned int n){
 	glUniform1i(_numSamplesLocation, n);
 	glUniform2fv(_sampleMapLocation, n, SOBOL_MAPS[sobol_index]);
 }
+
+int TextureShader::compile()
+{
+	int error = 0;
+	_programID = compileShaderProgram(MANDEL_VERTEX_SHADER, MANDEL_TEXTURE_FRAGMENT_SHADER, &error);
+	if(_programID > 0){
+		_vertexLocation = glGetAttribLocation(_programID, "vertex");
+		_imageSizeLocation = glGetUniformLocation(_programID, "image_size");
+		_imageOffsetLocation = glGetUniformLocation(_programID, "image_offset");
+		_imageLocation = glGetUniformLocation(_programID, "image");
+		_imageIterationsLocation = glGetUniformLocation(_programID, "image_iterations");
+		_maxIterationsLocation = glGetUniformLocation(_programID, "max_iterations");
+		_colorOffsetLocation = glGetUniformLocation(_programID, "color_offset");
+		_colorMapLocation = glGetUniformLocation(_programID, "color_map");
+		use();
+		glUniform1i(_imageLocation, MANDEL_IMAGE_TEXTURE_UNIT);
+		glUniform1i(_colorMapLocation, 0);
+	}
+	return error;
+}
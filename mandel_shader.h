@@ -1,50 +1,126 @@
 #include "glew/glew.h"
+#include "mandel_sobol.h"
 #include <stdio.h>
 
 extern const char * MANDEL_VERTEX_SHADER;
 extern const char * MANDEL_FRAGMENT_SHADER;
 extern const char * MANDEL_FRAGMENT_SHADER_DOUBLE;
-#define NUM_SOBOL_MAPS 5
-extern const float * SOBOL_MAPS[NUM_SOBOL_MAPS];
+extern const char * MANDEL_FRAGMENT_SHADER_DOUBLE_FLOAT;
+extern const char * MANDEL_TEXTURE_FRAGMENT_SHADER;
+
+// texture unit used for images drawn with TextureShader (unit 0 holds the color map)
+#define MANDEL_IMAGE_TEXTURE_UNIT 1
+
+enum MandelShaderPrecision{
+	MANDEL_SHADER_FLOAT = 0,
+	MANDEL_SHADER_DOUBLE,// native doubles, requires OpenGL 4.1
+	MANDEL_SHADER_DOUBLE_FLOAT// doubles emulated by float pairs, OpenGL 2.1
+};
+
+// compile and link shader program, number of errors is written to error_count
+GLuint compileShaderProgram(const char * vertex_source, const char * fragment_source, int * error_count);
 
 class MandelShader{
 public:
 	// compile shader
-	int compile(bool double_precision);
+	int compile(MandelShaderPrecision precision);
 	void use(){glUseProgram(_programID);}
 	GLint getVertexLocation(){return _vertexLocation;}
-	void setWindowSize(int w, int h){glUniform2f(_windowSizeLocation, w, h);}
+	// fractional sizes are used to render a downscaled frame
+	void setWindowSize(float w, float h){glUniform2f(_windowSizeLocation, w, h);}
 	void setTransform(double * mat3){
-		if(!_doublePrecision){
+		if(_precision == MANDEL_SHADER_DOUBLE){
+			glUniformMatrix3dv(_transformLocation, 1, GL_FALSE, mat3);
+		}
+		else{
 			float mat3f[9];
+			float mat3f_lo[9];
 			for(int i = 0; i < 9; i++)
-				mat3f[i] = static_cast<float>(mat3[i]);
+				splitDouble(mat3[i], mat3f[i], mat3f_lo[i]);
 			glUniformMatrix3fv(_transformLocation, 1, GL_FALSE, mat3f);
-		}
-		else{
-			glUniformMatrix3dv(_transformLocation, 1, GL_FALSE, mat3);
+			if(_precision == MANDEL_SHADER_DOUBLE_FLOAT)
+				glUniformMatrix3fv(_transformLoLocation, 1, GL_FALSE, mat3f_lo);
 		}
 	}
 	void setMaxIterations(int max_i){glUniform1i(_maxIterationsLocation, max_i);}
 	void setJuliaC(double *c){
-		if(!_doublePrecision)
-			glUniform2f(_juliaCLocation, c[0], c[1]);
-		else
+		if(_precision == MANDEL_SHADER_DOUBLE){
 			glUniform2d(_juliaCLocation, c[0], c[1]);
+		}
+		else{
+			float hi[2];
+			float lo[2];
+			splitDouble(c[0], hi[0], lo[0]);
+			splitDouble(c[1], hi[1], lo[1]);
+			glUniform2f(_juliaCLocation, hi[0], hi[1]);
+			if(_precision == MANDEL_SHADER_DOUBLE_FLOAT)
+				glUniform2f(_juliaCLoLocation, lo[0], lo[1]);
+		}
 	}
 	void setJulia(bool enabled){glUniform1i(_juliaLocation, enabled ? 1 : 0);}
+	// skip the main cardioid and the period-2 bulb
+	void setInteriorCheck(bool enabled){glUniform1i(_interiorCheckLocation, enabled ? 1 : 0);}
+	// distance in fractal coordinates for the periodicity check, 0 disables it
+	void setPeriodicityTolerance(double tolerance){glUniform1f(_periodicityToleranceLocation, tolerance);}
+	// shift of the color map for escaped points (0..1)
+	void setColorOffset(float offset){glUniform1f(_colorOffsetLocation, offset);}
+	// write escape iterations (for TextureShader::setIterations) instead of colors, only with one sample
+	void setOutputIterations(bool enabled){glUniform1i(_outputIterationsLocation, enabled ? 1 : 0);}
+	// multisample only pixels whose neighbourhood differs in the iterations of a single sample pass,
+	// which are read from the texture bound to MANDEL_IMAGE_TEXTURE_UNIT (written with setOutputIterations)
+	void setAdaptiveSampling(bool enabled){glUniform1i(_adaptiveSamplingLocation, enabled ? 1 : 0);}
 
 	void setNumSamples(unsigned int n);
 private:
-	bool _doublePrecision;
+	// d = hi + lo, for MANDEL_FRAGMENT_SHADER_DOUBLE_FLOAT
+	static void splitDouble(double d, float & hi, float & lo){
+		hi = static_cast<float>(d);
+		lo = static_cast<float>(d - hi);
+	}
+	MandelShaderPrecision _precision;
 	GLuint _programID;
 	GLint _vertexLocation;
 	GLint _windowSizeLocation;
 	GLint _transformLocation;
+	GLint _transformLoLocation;
 	GLint _colorMapLocation;
 	GLint _maxIterationsLocation;
 	GLint _juliaCLocation;
+	GLint _juliaCLoLocation;
 	GLint _juliaLocation;
+	GLint _interiorCheckLocation;
+	GLint _periodicityToleranceLocation;
+	GLint _colorOffsetLocation;
+	GLint _outputIterationsLocation;
+	GLint _adaptiveSamplingLocation;
+	GLint _firstPassLocation;
 	GLint _numSamplesLocation;
 	GLint _sampleMapLocation;
 };
+
+// draws a 2D texture over the window (e.g. a frame rendered on the cpu)
+class TextureShader{
+public:
+	int compile();
+	void use(){glUseProgram(_programID);}
+	GLint getVertexLocation(){return _vertexLocation;}
+	// size of the whole texture in window pixels (texture size times the downscale factor)
+	void setImageSize(float w, float h){glUniform2f(_imageSizeLocation, w, h);}
+	// position of the lower left texture corner in window pixels, nothing is drawn outside the texture
+	void setImageOffset(float x, float y){glUniform2f(_imageOffsetLocation, x, y);}
+	// image holds escape iterations written by the iteration pass of MandelShader, colored with the
+	// color map (texture unit 0) just like MandelShader would
+	void setIterations(bool enabled){glUniform1i(_imageIterationsLocation, enabled ? 1 : 0);}
+	void setMaxIterations(int max_i){glUniform1i(_maxIterationsLocation, max_i);}
+	void setColorOffset(float offset){glUniform1f(_colorOffsetLocation, offset);}
+private:
+	GLuint _programID;
+	GLint _vertexLocation;
+	GLint _imageSizeLocation;
+	GLint _imageOffsetLocation;
+	GLint _imageIterationsLocation;
+	GLint _maxIterationsLocation;
+	GLint _colorOffsetLocation;
+	GLint _colorMapLocation;
+	GLint _imageLocation;
+};
@@ -1,3 +1,5 @@
+#include "mandel_sobol.h"
+
 const char * MANDEL_VERTEX_SHADER = 
 	"#version 120\n"
 	"attribute vec2 vertex;\n"
@@ -18,6 +20,74 @@ const char * MANDEL_VERTEX_SHADER =
 " }\n" \
 "color /= float(num_samples);\n" \
 
+// color map coordinate of the escape iteration it (max_iterations: not escaped),
+// escaped points are shifted by color_offset (0..1) and wrap around
+#define COLOR_FUNCTION \
+"uniform float color_offset = 0.0;\n" \
+"float color_coordinate(int it){\n" \
+"  if(it >= max_iterations) return 1.0;\n" \
+"  float s = float(it)/float(max_iterations-1) + color_offset;\n" \
+"  return s > 1.0 ? s - 1.0 : s;\n" \
+"}\n"
+
+// iteration pass: the escape iteration is written as 24 bit integer to rgb instead of a color,
+// the color is looked up when the frame is drawn (see MANDEL_TEXTURE_FRAGMENT_SHADER)
+#define ITERATION_OUTPUT_FUNCTION \
+"uniform int output_iterations = 0;\n" \
+"vec4 pack_iterations(int it){\n" \
+"  vec3 bytes = mod(floor(vec3(float(it))/vec3(1.0, 256.0, 65536.0)), 256.0);\n" \
+"  return vec4(bytes/255.0, 1.0);\n" \
+"}\n"
+
+// reads an escape iteration written by pack_iterations()
+#define ITERATION_INPUT_FUNCTION \
+"int unpack_iterations(vec4 texel){\n" \
+"  return int(dot(floor(texel.rgb*255.0 + 0.5), vec3(1.0, 256.0, 65536.0)));\n" \
+"}\n"
+
+// adaptive multisampling: first_pass holds the iterations of a single sample pass over the whole window,
+// only pixels whose 3x3 neighbourhood differs in iterations are sampled again
+#define ADAPTIVE_SAMPLING_FUNCTION(TEXTURE2D) \
+ITERATION_INPUT_FUNCTION \
+"uniform int adaptive_sampling = 0;\n" \
+"uniform sampler2D first_pass;\n" \
+"bool needs_samples(out int it){\n" \
+"  it = unpack_iterations(" TEXTURE2D "(first_pass, gl_FragCoord.xy/window_size));\n" \
+"  for(int y = -1; y <= 1; y++){\n" \
+"    for(int x = -1; x <= 1; x++){\n" \
+"      if(unpack_iterations(" TEXTURE2D "(first_pass, (gl_FragCoord.xy + vec2(x, y))/window_size)) != it) return true;\n" \
+"    }\n" \
+"  }\n" \
+"  return false;\n" \
+"}\n"
+
+// uniform pixels get the color of their first pass sample
+#define ADAPTIVE_SAMPLING_CHECK(TEXTURE1D, OUTPUT) \
+"  int first_it;\n" \
+"  if(adaptive_sampling != 0 && !needs_samples(first_it)){\n" \
+"    " OUTPUT " = " TEXTURE1D "(color_map, color_coordinate(first_it));\n" \
+"    return;\n" \
+"  }\n"
+
+// closed form test for the main cardioid and the period-2 bulb, points inside never escape
+#define INTERIOR_CHECK_FUNCTION(VEC2, REAL) \
+"bool in_cardioid_or_bulb(" VEC2 " c){\n" \
+"  " REAL " xq = c.x - 0.25;\n" \
+"  " REAL " q = xq*xq + c.y*c.y;\n" \
+"  if(q*(q + xq) <= 0.25*c.y*c.y) return true;\n" \
+"  return (c.x + 1.0)*(c.x + 1.0) + c.y*c.y <= 0.0625;\n" \
+"}\n"
+
+// Brent's cycle detection: z is compared with the orbit point saved at iteration check,
+// which is moved forward in doubling steps
+#define PERIODICITY_FUNCTION(VEC2) \
+"bool is_periodic(" VEC2 " z, inout " VEC2 " saved, int i, inout int check){\n" \
+"  " VEC2 " d = z - saved;\n" \
+"  if(dot(d, d) < periodicity_tolerance*periodicity_tolerance) return true;\n" \
+"  if(i == check){saved = z; check *= 2;}\n" \
+"  return false;\n" \
+"}\n"
+
 const char * MANDEL_FRAGMENT_SHADER = 
 	"#version 120\n"
 	"uniform int max_iterations;\n"
@@ -25,33 +95,48 @@ const char * MANDEL_FRAGMENT_SHADER =
 	"uniform vec2 window_size;\n"
 	"uniform vec2 julia_c;\n"
 	"uniform int julia = 0;\n"
+	"uniform int interior_check = 1;\n"
+	"uniform float periodicity_tolerance = 0.0;\n"
 	"uniform int ms = 0;\n"
 	SOBOL_MAP_DECLARATION
 	"uniform sampler1D color_map;\n"
+	COLOR_FUNCTION
+	ITERATION_OUTPUT_FUNCTION
+	ADAPTIVE_SAMPLING_FUNCTION("texture2D")
 	"vec2 mandel_iterate(vec2 z, vec2 c){\n"
 	"  return vec2(z.x*z.x - z.y*z.y + c.x, 2*z.x*z.y + c.y);\n"
 	"}\n"
 	"float lensqrd(vec2 v){return v.x*v.x + v.y*v.y;}\n"
+	INTERIOR_CHECK_FUNCTION("vec2", "float")
+	PERIODICITY_FUNCTION("vec2")
 	"void main(void){\n"
+	ADAPTIVE_SAMPLING_CHECK("texture1D", "gl_FragColor")
 	"  vec4 color = vec4(0);\n"
 	SOBOL_SAMPLING_START
 	"  vec2 p = vec2(2*(gl_FragCoord.xy+sobol_map[sample_i])/window_size - vec2(1, 1));\n"
 	"  p = (transform*vec3(p, 1)).xy;\n"
-	"  float s = 1;"
+	"  int it = max_iterations;\n"
 	"  if(julia == 0){\n"
 	"  vec2 z = vec2(0,0);\n"
-	"  for(int i = 0; i < max_iterations; i++){\n"
-	"    if(lensqrd(z) > 4.0){s = float(i)/float(max_iterations-1); break;}\n"
+	"  vec2 saved = z;\n"
+	"  int check = 1;\n"
+	"  int n = (interior_check != 0 && in_cardioid_or_bulb(p)) ? 0 : max_iterations;\n"
+	"  for(int i = 0; i < n; i++){\n"
+	"    if(lensqrd(z) > 4.0){it = i; break;}\n"
 	"    z = mandel_iterate(z, p);\n"
+	"    if(periodicity_tolerance > 0.0 && is_periodic(z, saved, i, check)) break;\n"
 	"  }\n"
 	"  }else{\n"
 	"  vec2 z = p;\n"
+	"  vec2 saved = z;\n"
+	"  int check = 1;\n"
 	"  for(int i = 0; i < max_iterations; i++){\n"
-	"    if(lensqrd(z) >= 4.0){s = float(i)/float(max_iterations-1); break;}\n"
+	"    if(lensqrd(z) >= 4.0){it = i; break;}\n"
 	"    z = mandel_iterate(z, julia_c);\n"
+	"    if(periodicity_tolerance > 0.0 && is_periodic(z, saved, i, check)) break;\n"
 	"  }\n"
 	"  }\n"
-	"  color += texture1D(color_map, s);\n"
+	"  color += output_iterations != 0 ? pack_iterations(it) : texture1D(color_map, color_coordinate(it));\n"
 	SOBOL_SAMPLING_END
 	"  gl_FragColor = color;"
 	"}"
@@ -66,33 +151,174 @@ const char * MANDEL_FRAGMENT_SHADER_DOUBLE =
 	"uniform vec2 window_size;\n"
 	"uniform dvec2 julia_c;\n"
 	"uniform int julia = 0;\n"
+	"uniform int interior_check = 1;\n"
+	"uniform float periodicity_tolerance = 0.0;\n"
 	SOBOL_MAP_DECLARATION
 	"uniform sampler1D color_map;\n"
+	COLOR_FUNCTION
+	ITERATION_OUTPUT_FUNCTION
+	ADAPTIVE_SAMPLING_FUNCTION("texture")
 	"dvec2 mandel_iterate(dvec2 z, dvec2 c){\n"
 	"  return dvec2(z.x*z.x - z.y*z.y + c.x, 2*z.x*z.y + c.y);\n"
 	"}\n"
 	"double lensqrd(dvec2 v){return sqrt(v.x*v.x + v.y*v.y);}\n"
+	INTERIOR_CHECK_FUNCTION("dvec2", "double")
+	PERIODICITY_FUNCTION("dvec2")
 	"void main(void){\n"
+	ADAPTIVE_SAMPLING_CHECK("texture", "color")
 	"  color = vec4(0, 0, 0, 0);\n"
 	SOBOL_SAMPLING_START
 	"  dvec2 p = dvec2(2*(gl_FragCoord.xy+sobol_map[sample_i])/window_size - dvec2(1, 1));\n"
 	"  p = (transform*dvec3(p, 1)).xy;\n"
-	"  float s = 1;\n"
+	"  int it = max_iterations;\n"
 	"  if(julia == 0){\n"
 	"  dvec2 z = dvec2(0,0);\n"
-	"  for(int i = 0; i < max_iterations; i++){\n"
-	"    if(lensqrd(z) >= 4.0){s = float(i)/float(max_iterations-1); break;}\n"
+	"  dvec2 saved = z;\n"
+	"  int check = 1;\n"
+	"  int n = (interior_check != 0 && in_cardioid_or_bulb(p)) ? 0 : max_iterations;\n"
+	"  for(int i = 0; i < n; i++){\n"
+	"    if(lensqrd(z) >= 4.0){it = i; break;}\n"
 	"    z = mandel_iterate(z, p);\n"
+	"    if(periodicity_tolerance > 0.0 && is_periodic(z, saved, i, check)) break;\n"
 	"  }\n"
 	"  }else{\n"
 	"  dvec2 z = p;\n"
+	"  dvec2 saved = z;\n"
+	"  int check = 1;\n"
 	"  for(int i = 0; i < max_iterations; i++){\n"
-	"    if(lensqrd(z) >= 4.0){s = float(i)/float(max_iterations-1); break;}\n"
+	"    if(lensqrd(z) >= 4.0){it = i; break;}\n"
 	"    z = mandel_iterate(z, julia_c);\n"
+	"    if(periodicity_tolerance > 0.0 && is_periodic(z, saved, i, check)) break;\n"
+	"  }\n"
+	"  }\n"
+	"  color += output_iterations != 0 ? pack_iterations(it) : texture(color_map, color_coordinate(it));\n"
+	SOBOL_SAMPLING_END
+	"}"
+;
+
+// double precision emulated by float pairs (hi, lo) with hi+lo = value,
+// GLSL 1.20 only, ~48 bit mantissa.
+// transform/julia_c hold the hi parts, transform_lo/julia_c_lo the remainders.
+// Complex numbers are stored as vec4(re.hi, re.lo, im.hi, im.lo).
+const char * MANDEL_FRAGMENT_SHADER_DOUBLE_FLOAT = 
+	"#version 120\n"
+	"uniform int max_iterations;\n"
+	"uniform mat3 transform;\n"
+	"uniform mat3 transform_lo;\n"
+	"uniform vec2 window_size;\n"
+	"uniform vec2 julia_c;\n"
+	"uniform vec2 julia_c_lo;\n"
+	"uniform int julia = 0;\n"
+	"uniform int interior_check = 1;\n"
+	"uniform float periodicity_tolerance = 0.0;\n"
+	SOBOL_MAP_DECLARATION
+	"uniform sampler1D color_map;\n"
+	COLOR_FUNCTION
+	ITERATION_OUTPUT_FUNCTION
+	ADAPTIVE_SAMPLING_FUNCTION("texture2D")
+	// Knuth's two-sum
+	"vec2 ff_add(vec2 a, vec2 b){\n"
+	"  float s = a.x + b.x;\n"
+	"  float v = s - a.x;\n"
+	"  float e = (a.x - (s - v)) + (b.x - v) + a.y + b.y;\n"
+	"  float hi = s + e;\n"
+	"  return vec2(hi, e - (hi - s));\n"
+	"}\n"
+	// Dekker's split and two-product
+	"vec2 ff_split(float a){\n"
+	"  float t = 4097.0*a;\n"
+	"  float hi = t - (t - a);\n"
+	"  return vec2(hi, a - hi);\n"
+	"}\n"
+	"vec2 ff_mul(vec2 a, vec2 b){\n"
+	"  float p = a.x*b.x;\n"
+	"  vec2 a_split = ff_split(a.x);\n"
+	"  vec2 b_split = ff_split(b.x);\n"
+	"  float e = ((a_split.x*b_split.x - p) + a_split.x*b_split.y + a_split.y*b_split.x) + a_split.y*b_split.y;\n"
+	"  e += a.x*b.y + a.y*b.x;\n"
+	"  float hi = p + e;\n"
+	"  return vec2(hi, e - (hi - p));\n"
+	"}\n"
+	// dot product of a transform row (hi, lo) with (p, 1)
+	"vec2 ff_transform(vec3 row, vec3 row_lo, vec2 p){\n"
+	"  vec2 x = ff_mul(vec2(row.x, row_lo.x), vec2(p.x, 0));\n"
+	"  vec2 y = ff_mul(vec2(row.y, row_lo.y), vec2(p.y, 0));\n"
+	"  return ff_add(ff_add(x, y), vec2(row.z, row_lo.z));\n"
+	"}\n"
+	"bool in_cardioid_or_bulb(vec4 c){\n"
+	"  vec2 xq = ff_add(c.xy, vec2(-0.25, 0));\n"
+	"  vec2 y2 = ff_mul(c.zw, c.zw);\n"
+	"  vec2 q = ff_add(ff_mul(xq, xq), y2);\n"
+	"  if(ff_add(ff_mul(q, ff_add(q, xq)), -0.25*y2).x <= 0.0) return true;\n"
+	"  vec2 xb = ff_add(c.xy, vec2(1, 0));\n"
+	"  return ff_add(ff_add(ff_mul(xb, xb), y2), vec2(-0.0625, 0)).x <= 0.0;\n"
+	"}\n"
+	// Brent's cycle detection, see PERIODICITY_FUNCTION
+	"bool is_periodic(vec4 z, inout vec4 saved, int i, inout int check){\n"
+	"  vec2 d = vec2(ff_add(z.xy, -saved.xy).x, ff_add(z.zw, -saved.zw).x);\n"
+	"  if(dot(d, d) < periodicity_tolerance*periodicity_tolerance) return true;\n"
+	"  if(i == check){saved = z; check *= 2;}\n"
+	"  return false;\n"
+	"}\n"
+	"vec4 mandel_iterate(vec4 z, vec2 x2, vec2 y2, vec4 c){\n"
+	"  vec2 xy = ff_mul(z.xy, z.zw);\n"
+	"  return vec4(ff_add(ff_add(x2, -y2), c.xy), ff_add(2.0*xy, c.zw));\n"
+	"}\n"
+	"void main(void){\n"
+	ADAPTIVE_SAMPLING_CHECK("texture1D", "gl_FragColor")
+	"  vec4 color = vec4(0);\n"
+	SOBOL_SAMPLING_START
+	"  vec2 p = vec2(2*(gl_FragCoord.xy+sobol_map[sample_i])/window_size - vec2(1, 1));\n"
+	"  vec2 cx = ff_transform(vec3(transform[0][0], transform[1][0], transform[2][0]),\n"
+	"                         vec3(transform_lo[0][0], transform_lo[1][0], transform_lo[2][0]), p);\n"
+	"  vec2 cy = ff_transform(vec3(transform[0][1], transform[1][1], transform[2][1]),\n"
+	"                         vec3(transform_lo[0][1], transform_lo[1][1], transform_lo[2][1]), p);\n"
+	"  vec4 c = vec4(cx, cy);\n"
+	"  int it = max_iterations;\n"
+	"  vec4 z = c;\n"
+	"  int n = max_iterations;\n"
+	"  if(julia == 0){\n"
+	"    z = vec4(0);\n"
+	"    if(interior_check != 0 && in_cardioid_or_bulb(c)) n = 0;\n"
+	"  }else{\n"
+	"    c = vec4(julia_c.x, julia_c_lo.x, julia_c.y, julia_c_lo.y);\n"
 	"  }\n"
+	"  vec4 saved = z;\n"
+	"  int check = 1;\n"
+	"  for(int i = 0; i < n; i++){\n"
+	"    vec2 x2 = ff_mul(z.xy, z.xy);\n"
+	"    vec2 y2 = ff_mul(z.zw, z.zw);\n"
+	"    float len = x2.x + y2.x;\n"
+	"    if(julia == 0 ? len > 4.0 : len >= 4.0){it = i; break;}\n"
+	"    z = mandel_iterate(z, x2, y2, c);\n"
+	"    if(periodicity_tolerance > 0.0 && is_periodic(z, saved, i, check)) break;\n"
 	"  }\n"
-	"  color += texture(color_map, s);\n"
+	"  color += output_iterations != 0 ? pack_iterations(it) : texture1D(color_map, color_coordinate(it));\n"
 	SOBOL_SAMPLING_END
+	"  gl_FragColor = color;"
+	"}"
+;
+
+// draws texture bound to MANDEL_IMAGE_TEXTURE_UNIT,
+// images written by an iteration pass are colored if image_iterations is set
+const char * MANDEL_TEXTURE_FRAGMENT_SHADER = 
+	"#version 120\n"
+	"uniform vec2 image_size;\n"
+	"uniform vec2 image_offset = vec2(0, 0);\n"
+	"uniform sampler2D image;\n"
+	"uniform int image_iterations = 0;\n"
+	"uniform int max_iterations;\n"
+	"uniform sampler1D color_map;\n"
+	COLOR_FUNCTION
+	ITERATION_INPUT_FUNCTION
+	"void main(void){\n"
+	"  vec2 uv = (gl_FragCoord.xy-image_offset)/image_size;\n"
+	"  if(uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) discard;\n"
+	"  vec4 texel = texture2D(image, uv);\n"
+	"  if(image_iterations != 0){\n"
+	"    texel = texture1D(color_map, color_coordinate(unpack_iterations(texel)));\n"
+	"  }\n"
+	"  gl_FragColor = texel;\n"
 	"}"
 ;
 
@@ -147,7 +373,7 @@ const float SOBOL_MAP_16[32] = {
 	 0.375, -0.375
 };
 
-const float *SOBOL_MAPS[5] = {
+const float *SOBOL_MAPS[NUM_SOBOL_MAPS] = {
 	SOBOL_MAP_1,
 	SOBOL_MAP_2,
 	SOBOL_MAP_4,
@@ -0,0 +1,8 @@
+#ifndef MANDEL_SOBOL_H
+#define MANDEL_SOBOL_H
+
+// sample offsets (in pixels) used for multisampling, SOBOL_MAPS[i] holds 2^i samples
+#define NUM_SOBOL_MAPS 5
+extern const float * SOBOL_MAPS[NUM_SOBOL_MAPS];
+
+#endif
@@ -0,0 +1,274 @@
+#include "mandel_tile_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <time.h>
+
+// start of every tile file, followed by the iteration counts
+struct MandelTileHeader{
+	char magic[8];// MANDEL_TILE_CACHE_MAGIC without terminating zero
+	int32_t level;
+	int32_t maxIterations;
+	int64_t x;
+	int64_t y;
+	uint32_t julia;
+	uint32_t tileSize;
+	double juliaC[2];
+	double periodicityTolerance;
+};
+
+static const char * MANDEL_TILE_EXTENSION = ".tile";
+static const char * MANDEL_TILE_TEMP_EXTENSION = ".tmp";
+
+static bool endsWith(const std::string & s, const char * suffix)
+{
+	size_t n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size()-n, n, suffix) == 0;
+}
+
+// temporary file <tile>.<pid>.tmp that no process will finish anymore
+static bool isAbandoned(const std::string & path, time_t modified)
+{
+	if(time(NULL) - modified > MANDEL_TILE_CACHE_TEMP_AGE)
+		return true;
+	size_t end = path.size() - strlen(MANDEL_TILE_TEMP_EXTENSION);
+	size_t start = path.rfind('.', end-1);
+	if(start == std::string::npos)
+		return true;
+	int pid = atoi(path.substr(start+1, end-start-1).c_str());
+	// this process is not writing while opening the cache, EPERM: running as another user
+	return pid <= 0 || pid == static_cast<int>(getpid()) || (kill(pid, 0) != 0 && errno == ESRCH);
+}
+
+// creates all directories of path (up to the last '/')
+static int makeDirectories(const std::string & path)
+{
+	for(size_t i = 1; i < path.size(); i++){
+		if(path[i] != '/')
+			continue;
+		std::string dir = path.substr(0, i);
+		if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST){
+			printf("Failed to create directory '%s'!\n", dir.c_str());
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void initTileHeader(MandelTileHeader & header, const MandelTileKey & key)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MANDEL_TILE_CACHE_MAGIC, sizeof(header.magic));
+	header.level = key.level;
+	header.maxIterations = key.maxIterations;
+	header.x = key.x;
+	header.y = key.y;
+	header.julia = key.julia ? 1 : 0;
+	header.tileSize = MANDEL_TILE_CACHE_TILE_SIZE;
+	header.juliaC[0] = key.julia ? key.juliaC[0] : 0;
+	header.juliaC[1] = key.julia ? key.juliaC[1] : 0;
+	header.periodicityTolerance = key.periodicityTolerance;
+}
+
+bool MandelTileCache::usedBefore(const Entry & a, const Entry & b)
+{
+	return a.lastUse < b.lastUse;
+}
+
+MandelTileCache::MandelTileCache()
+{
+	_maxBytes = 0;
+	_size = 0;
+	_hits = 0;
+	_misses = 0;
+}
+
+int MandelTileCache::open(const char * dir, uint64_t max_bytes)
+{
+	_dir = dir;
+	if(_dir.empty() || _dir[_dir.size()-1] != '/')
+		_dir += '/';
+	_maxBytes = max_bytes;
+	_size = 0;
+	_lru.clear();
+	_entries.clear();
+	if(makeDirectories(_dir)){
+		_dir.clear();
+		return 1;
+	}
+	scan("");
+	// oldest first
+	std::vector<Entry> entries(_lru.begin(), _lru.end());
+	std::stable_sort(entries.begin(), entries.end(), usedBefore);
+	_lru.assign(entries.begin(), entries.end());
+	for(std::list<Entry>::iterator it = _lru.begin(); it != _lru.end(); ++it){
+		_entries[it->path] = it;
+	}
+	evict();
+	return 0;
+}
+
+void MandelTileCache::scan(const std::string & relative_dir)
+{
+	std::string dir = _dir + relative_dir;
+	DIR * d = opendir(dir.c_str());
+	if(d == NULL)
+		return;
+	while(struct dirent * e = readdir(d)){
+		if(!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+			continue;
+		std::string path = relative_dir + e->d_name;
+		std::string full_path = _dir + path;
+		struct stat st;
+		if(stat(full_path.c_str(), &st) != 0)
+			continue;
+		if(S_ISDIR(st.st_mode)){
+			scan(path + "/");
+		}
+		else if(endsWith(path, MANDEL_TILE_TEMP_EXTENSION)){
+			// left by a process that did not finish writing it, other instances may still be writing theirs
+			if(isAbandoned(path, st.st_mtime))
+				unlink(full_path.c_str());
+		}
+		else if(endsWith(path, MANDEL_TILE_EXTENSION)){
+			Entry entry = {path, static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime)};
+			_lru.push_back(entry);
+			_size += entry.size;
+		}
+	}
+	closedir(d);
+}
+
+std::string MandelTileCache::getPath(const MandelTileKey & key)
+{
+	char path[256];
+	int len;
+	if(key.julia){
+		// exact bits of c, nearby julia sets are different sets
+		unsigned long long c[2];
+		memcpy(&c[0], &key.juliaC[0], sizeof(c[0]));
+		memcpy(&c[1], &key.juliaC[1], sizeof(c[1]));
+		len = snprintf(path, sizeof(path), "julia_%d_%016llx_%016llx/", key.maxIterations, c[0], c[1]);
+	}
+	else{
+		len = snprintf(path, sizeof(path), "mandelbrot_%d/", key.maxIterations);
+	}
+	if(key.periodicityTolerance > 0){// stopped points may differ, so these tiles are kept apart
+		unsigned long long tolerance;
+		memcpy(&tolerance, &key.periodicityTolerance, sizeof(tolerance));
+		len--;// before the '/'
+		len += snprintf(path + len, sizeof(path) - len, "_p%016llx/", tolerance);
+	}
+	snprintf(path + len, sizeof(path) - len, "%d/%lld_%lld%s", key.level,
+		static_cast<long long>(key.x), static_cast<long long>(key.y), MANDEL_TILE_EXTENSION);
+	return path;
+}
+
+bool MandelTileCache::load(const MandelTileKey & key, int32_t * iterations)
+{
+	std::string path = getPath(key);
+	std::string full_path = _dir + path;
+	FILE * f = fopen(full_path.c_str(), "rb");
+	if(f == NULL){
+		_misses++;
+		return false;
+	}
+	MandelTileHeader expected, header;
+	initTileHeader(expected, key);
+	const size_t n = MANDEL_TILE_CACHE_TILE_SIZE*MANDEL_TILE_CACHE_TILE_SIZE;
+	bool valid = fread(&header, sizeof(header), 1, f) == 1 && memcmp(&header, &expected, sizeof(header)) == 0 &&
+		fread(iterations, sizeof(int32_t), n, f) == n;
+	fclose(f);
+	if(!valid){
+		printf("Removing invalid tile '%s' from the cache.\n", full_path.c_str());
+		remove(path);
+		_misses++;
+		return false;
+	}
+	touch(path);
+	_hits++;
+	return true;
+}
+
+int MandelTileCache::store(const MandelTileKey & key, const int32_t * iterations)
+{
+	std::string path = getPath(key);
+	std::string full_path = _dir + path;
+	if(makeDirectories(full_path)){
+		return 1;
+	}
+	// renamed when complete, readers never see a partial tile
+	char temp_path[512];
+	snprintf(temp_path, sizeof(temp_path), "%s.%d%s", full_path.c_str(), static_cast<int>(getpid()), MANDEL_TILE_TEMP_EXTENSION);
+	FILE * f = fopen(temp_path, "wb");
+	if(f == NULL){
+		printf("Failed to open '%s' for writing!\n", temp_path);
+		return 1;
+	}
+	MandelTileHeader header;
+	initTileHeader(header, key);
+	const size_t n = MANDEL_TILE_CACHE_TILE_SIZE*MANDEL_TILE_CACHE_TILE_SIZE;
+	bool error = fwrite(&header, sizeof(header), 1, f) != 1 || fwrite(iterations, sizeof(int32_t), n, f) != n;
+	if(fclose(f) != 0 || error || rename(temp_path, full_path.c_str()) != 0){
+		printf("Failed to write tile '%s'!\n", full_path.c_str());
+		unlink(temp_path);
+		return 1;
+	}
+	std::map<std::string, std::list<Entry>::iterator>::iterator it = _entries.find(path);
+	if(it != _entries.end()){// replaced
+		_size -= it->second->size;
+		_lru.erase(it->second);
+	}
+	Entry entry = {path, sizeof(header) + n*sizeof(int32_t), 0};
+	_lru.push_back(entry);
+	_entries[path] = --_lru.end();
+	_size += entry.size;
+	evict();
+	return 0;
+}
+
+void MandelTileCache::touch(const std::string & path)
+{
+	std::map<std::string, std::list<Entry>::iterator>::iterator it = _entries.find(path);
+	if(it != _entries.end()){
+		_lru.splice(_lru.end(), _lru, it->second);
+	}
+	else{// written by another process since open()
+		struct stat st;
+		if(stat((_dir + path).c_str(), &st) == 0){
+			Entry entry = {path, static_cast<uint64_t>(st.st_size), 0};
+			_lru.push_back(entry);
+			_entries[path] = --_lru.end();
+			_size += entry.size;
+		}
+	}
+	// the order of the next open()
+	utime((_dir + path).c_str(), NULL);
+}
+
+void MandelTileCache::remove(const std::string & path)
+{
+	unlink((_dir + path).c_str());
+	std::map<std::string, std::list<Entry>::iterator>::iterator it = _entries.find(path);
+	if(it != _entries.end()){
+		_size -= it->second->size;
+		_lru.erase(it->second);
+		_entries.erase(it);
+	}
+}
+
+void MandelTileCache::evict()
+{
+	while(_size > _maxBytes && !_lru.empty()){
+		std::string path = _lru.front().path;
+		remove(path);
+	}
+}
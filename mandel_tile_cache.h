@@ -0,0 +1,80 @@
+#ifndef MANDEL_TILE_CACHE_H
+#define MANDEL_TILE_CACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <string>
+
+// Persistent cache of iteration counts in a quadtree tile pyramid. A tile of level l covers a square of
+// MANDEL_TILE_CACHE_ROOT_SIZE/2^l fractal units with its lower left corner at (x, y)*size, sampled at the centers
+// of MANDEL_TILE_CACHE_TILE_SIZE^2 cells, so a tile is split into four tiles of the next level.
+// Tiles are stored one file each as <dir>/<formula>/<level>/<x>_<y>.tile, see MandelTileCache::getPath.
+
+// samples per tile side
+#define MANDEL_TILE_CACHE_TILE_SIZE 256
+// side length of a level 0 tile in fractal coordinates
+#define MANDEL_TILE_CACHE_ROOT_SIZE 4.0
+#define MANDEL_TILE_CACHE_MAGIC "MANDTIL2"
+// seconds after which temporary files are removed even if the process that wrote them still runs
+#define MANDEL_TILE_CACHE_TEMP_AGE 600
+
+// everything the iteration counts of a tile depend on
+struct MandelTileKey{
+	int level;
+	int64_t x;
+	int64_t y;
+	int maxIterations;
+	bool julia;// formula: z^2 + c with z0 = 0 (mandelbrot) or z^2 + juliaC with z0 = c (julia)
+	double juliaC[2];
+	// MandelCPU::setPeriodicityCheck in samples, stopped points are stored as maxIterations
+	double periodicityTolerance;
+};
+
+// Tiles are written to a temporary file that is renamed when complete, so files are either whole or missing
+// and temporary files left by a crashed process (or older than MANDEL_TILE_CACHE_TEMP_AGE) are removed by open(). When the files exceed the size budget
+// the least recently used ones are deleted, the file modification time keeps the order across runs.
+// Not thread safe, tiles are loaded and stored by the thread rendering the view.
+class MandelTileCache{
+public:
+	MandelTileCache();
+	// creates dir if needed and indexes the tiles in it (evicting tiles above max_bytes), returns 0 on success
+	int open(const char * dir, uint64_t max_bytes);
+	bool isOpen(){return !_dir.empty();}
+	// reads the MANDEL_TILE_CACHE_TILE_SIZE^2 iteration counts of a tile (bottom row first),
+	// returns false if the tile is not cached
+	bool load(const MandelTileKey & key, int32_t * iterations);
+	// adds a tile, returns 0 on success
+	int store(const MandelTileKey & key, const int32_t * iterations);
+	uint64_t getHits(){return _hits;}
+	uint64_t getMisses(){return _misses;}
+	int getNumTiles(){return static_cast<int>(_entries.size());}
+	uint64_t getSize(){return _size;}
+	uint64_t getMaxSize(){return _maxBytes;}
+private:
+	// file of a tile relative to the cache directory
+	static std::string getPath(const MandelTileKey & key);
+	// adds the tiles below the cache directory to the index
+	void scan(const std::string & relative_dir);
+	// deletes least recently used tiles until the budget is kept
+	void evict();
+	// moves the tile to the end of the lru list and updates its modification time
+	void touch(const std::string & path);
+	void remove(const std::string & path);
+
+	struct Entry{
+		std::string path;// relative to _dir
+		uint64_t size;
+		int64_t lastUse;// modification time, only used to sort the tiles found by open()
+	};
+	static bool usedBefore(const Entry & a, const Entry & b);
+	std::string _dir;// with trailing '/'
+	uint64_t _maxBytes;
+	uint64_t _size;
+	std::list<Entry> _lru;// least recently used first
+	std::map<std::string, std::list<Entry>::iterator> _entries;
+	uint64_t _hits;
+	uint64_t _misses;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "mandel_tile_scheduler.h"
+
+MandelTileScheduler::MandelTileScheduler()
+{
+	_generation = 0;
+	_numFinished = 0;
+	_quit = false;
+	_func = NULL;
+	_user = NULL;
+	_numSteals = 0;
+	startThreads(1);
+}
+
+MandelTileScheduler::~MandelTileScheduler()
+{
+	stopThreads();
+}
+
+void MandelTileScheduler::setNumThreads(int n)
+{
+	if(n <= 0){
+		n = std::thread::hardware_concurrency();
+		if(n <= 0)
+			n = 1;
+	}
+	if(n == getNumThreads())
+		return;
+	stopThreads();
+	startThreads(n);
+}
+
+void MandelTileScheduler::startThreads(int n)
+{
+	_quit = false;
+	for(int i = 0; i < n; i++){
+		_queues.push_back(new TileQueue);
+	}
+	// workers wait for the next run(), not one that finished before they were started
+	uint64_t generation;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		generation = _generation;
+	}
+	for(int i = 1; i < n; i++){
+		_threads.push_back(std::thread(&MandelTileScheduler::workerLoop, this, i, generation));
+	}
+}
+
+void MandelTileScheduler::stopThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_startCondition.notify_all();
+	for(size_t i = 0; i < _threads.size(); i++){
+		_threads[i].join();
+	}
+	_threads.clear();
+	for(size_t i = 0; i < _queues.size(); i++){
+		delete _queues[i];
+	}
+	_queues.clear();
+}
+
+void MandelTileScheduler::run(int w, int h, int tile_size, TileFunc func, void * user)
+{
+	if(tile_size < 1)
+		tile_size = 1;
+	int tiles_x = (w+tile_size-1)/tile_size;
+	int tiles_y = (h+tile_size-1)/tile_size;
+	int num_tiles = tiles_x*tiles_y;
+	int num_workers = getNumThreads();
+	if(num_tiles <= 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_func = func;
+		_user = user;
+		// every worker starts with a contiguous band of tiles, stealing evens out the cost
+		for(int i = 0; i < num_tiles; i++){
+			MandelTile t;
+			t.x = (i%tiles_x)*tile_size;
+			t.y = (i/tiles_x)*tile_size;
+			t.w = w-t.x < tile_size ? w-t.x : tile_size;
+			t.h = h-t.y < tile_size ? h-t.y : tile_size;
+			int worker = static_cast<int>(static_cast<int64_t>(i)*num_workers/num_tiles);
+			_queues[worker]->tiles.push_back(t);
+		}
+		_numFinished = 0;
+		_generation++;
+	}
+	_startCondition.notify_all();
+
+	work(0);
+
+	// waiting for all workers, so none of them still uses _func when run() returns
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(_numFinished < num_workers-1){
+		_doneCondition.wait(lock);
+	}
+}
+
+void MandelTileScheduler::workerLoop(int worker, uint64_t generation)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true){
+		while(!_quit && _generation == generation){
+			_startCondition.wait(lock);
+		}
+		if(_quit)
+			break;
+		generation = _generation;
+		lock.unlock();
+		work(worker);
+		lock.lock();
+		_numFinished++;
+		_doneCondition.notify_all();
+	}
+}
+
+void MandelTileScheduler::work(int worker)
+{
+	MandelTile tile;
+	while(popTile(worker, tile) || stealTile(worker, tile)){
+		_func(tile, worker, _user);
+	}
+}
+
+bool MandelTileScheduler::popTile(int worker, MandelTile & tile)
+{
+	TileQueue * q = _queues[worker];
+	std::lock_guard<std::mutex> lock(q->mutex);
+	if(q->tiles.empty())
+		return false;
+	tile = q->tiles.front();
+	q->tiles.pop_front();
+	return true;
+}
+
+bool MandelTileScheduler::stealTile(int worker, MandelTile & tile)
+{
+	// visiting all other workers, starting with the next one so thieves spread over the victims
+	int n = getNumThreads();
+	for(int i = 1; i < n; i++){
+		int victim = (worker+i)%n;
+		TileQueue * q = _queues[victim];
+		std::lock_guard<std::mutex> lock(q->mutex);
+		if(!q->tiles.empty()){
+			// taking from the back, the owner works from the front
+			tile = q->tiles.back();
+			q->tiles.pop_back();
+			_numSteals++;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,64 @@
+#ifndef MANDEL_TILE_SCHEDULER_H
+#define MANDEL_TILE_SCHEDULER_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct MandelTile{
+	int x, y, w, h;
+};
+
+// Thread pool that renders a frame split into small tiles. Every worker owns a queue of tiles,
+// workers that run out of tiles steal from the back of another worker's queue,
+// so expensive regions of the frame get spread over all threads.
+class MandelTileScheduler{
+public:
+	// called for each tile, worker is in [0, getNumThreads())
+	typedef void (*TileFunc)(const MandelTile & tile, int worker, void * user);
+
+	MandelTileScheduler();
+	~MandelTileScheduler();
+
+	// number of threads (including the calling thread), 0 uses all hardware threads
+	void setNumThreads(int n);
+	int getNumThreads(){return static_cast<int>(_queues.size());}
+
+	// splits the w x h area into tiles of tile_size x tile_size and processes them,
+	// the calling thread takes part in the work, returns once all tiles are done
+	void run(int w, int h, int tile_size, TileFunc func, void * user);
+
+	// number of tiles that were taken from another worker's queue (since last reset)
+	uint64_t getNumSteals(){return _numSteals;}
+	void resetStats(){_numSteals = 0;}
+private:
+	struct TileQueue{
+		std::mutex mutex;
+		std::deque<MandelTile> tiles;
+	};
+	void startThreads(int n);
+	void stopThreads();
+	// generation: value of _generation when the worker was started
+	void workerLoop(int worker, uint64_t generation);
+	void work(int worker);
+	bool popTile(int worker, MandelTile & tile);
+	bool stealTile(int worker, MandelTile & tile);
+
+	std::vector<TileQueue*> _queues;// one per worker
+	std::vector<std::thread> _threads;// workers 1..n-1, worker 0 is the thread calling run()
+	std::mutex _mutex;
+	std::condition_variable _startCondition;
+	std::condition_variable _doneCondition;
+	uint64_t _generation;// incremented for each run()
+	int _numFinished;// threads done with the current generation
+	bool _quit;
+	TileFunc _func;
+	void * _user;
+	std::atomic<uint64_t> _numSteals;
+};
+
+#endif
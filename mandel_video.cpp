@@ -0,0 +1,201 @@
+#include "mandel_video.h"
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+static const char * MANDEL_VIDEO_FORMAT_NAMES[NUM_MANDEL_VIDEO_FORMATS] = {"y4m", "rgb"};
+
+MandelVideoFormat getMandelVideoFormat(const char * name)
+{
+	for(int i = 0; i < NUM_MANDEL_VIDEO_FORMATS; i++){
+		if(!strcmp(name, MANDEL_VIDEO_FORMAT_NAMES[i]))
+			return static_cast<MandelVideoFormat>(i);
+	}
+	return NUM_MANDEL_VIDEO_FORMATS;
+}
+
+MandelVideoWriter::MandelVideoWriter()
+{
+	_file = NULL;
+	_w = 0;
+	_h = 0;
+	_format = MANDEL_VIDEO_Y4M;
+	_error = false;
+}
+
+FILE * MandelVideoWriter::takeStdout()
+{
+	static FILE * video_out = NULL;
+	if(video_out == NULL){
+		fflush(stdout);
+		int fd = dup(STDOUT_FILENO);
+		if(fd >= 0){
+			dup2(STDERR_FILENO, STDOUT_FILENO);
+			video_out = fdopen(fd, "wb");
+		}
+	}
+	return video_out;
+}
+
+int MandelVideoWriter::open(const char * path, int w, int h, int fps, MandelVideoFormat format)
+{
+	close();
+	if(!strcmp(path, "-")){
+		_file = takeStdout();
+	}
+	else{
+		_file = fopen(path, "wb");
+	}
+	if(_file == NULL){
+		printf("Failed to open '%s' for writing!\n", path);
+		return 1;
+	}
+	_w = w;
+	_h = h;
+	_format = format;
+	_error = false;
+	_frame.resize(static_cast<size_t>(w)*h*3);
+	if(format == MANDEL_VIDEO_Y4M){
+		if(fprintf(_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", w, h, fps) < 0){
+			_error = true;
+		}
+	}
+	return _error ? 1 : 0;
+}
+
+int MandelVideoWriter::writeFrame(const uint32_t * rgba)
+{
+	if(_file == NULL || _error)
+		return 1;
+	size_t plane = static_cast<size_t>(_w)*_h;
+	for(int y = 0; y < _h; y++){
+		// video frames start with the top row
+		const uint32_t * src = rgba + static_cast<size_t>(_h-1-y)*_w;
+		size_t row = static_cast<size_t>(y)*_w;
+		for(int x = 0; x < _w; x++){
+			int r = src[x]&0xFF;
+			int g = (src[x]>>8)&0xFF;
+			int b = (src[x]>>16)&0xFF;
+			if(_format == MANDEL_VIDEO_RGB){
+				uint8_t * p = &_frame[(row + x)*3];
+				p[0] = r;
+				p[1] = g;
+				p[2] = b;
+			}
+			else{// planar, BT.601 limited range
+				_frame[row + x] = ((66*r + 129*g + 25*b + 128)>>8) + 16;
+				_frame[plane + row + x] = ((-38*r - 74*g + 112*b + 128)>>8) + 128;
+				_frame[2*plane + row + x] = ((112*r - 94*g - 18*b + 128)>>8) + 128;
+			}
+		}
+	}
+	if((_format == MANDEL_VIDEO_Y4M && fputs("FRAME\n", _file) < 0) ||
+		fwrite(&_frame[0], _frame.size(), 1, _file) != 1){
+		_error = true;
+		return 1;
+	}
+	return 0;
+}
+
+int MandelVideoWriter::close()
+{
+	if(_file == NULL)
+		return 0;
+	if(fclose(_file) != 0){
+		_error = true;
+	}
+	_file = NULL;
+	return _error ? 1 : 0;
+}
+
+// frames that are rendered or wait to be written, frame f uses buffer f%num_buffers
+struct MandelVideoQueue{
+	std::mutex mutex;
+	std::condition_variable frameCondition;// a frame was rendered
+	std::condition_variable bufferCondition;// a buffer was written
+	std::vector<std::vector<uint32_t> > buffers;
+	std::vector<bool> done;
+	int numFrames;
+	int nextFrame;// next frame to be rendered
+	int numWritten;
+	bool abort;
+	MandelFrameFunc func;
+	void * user;
+};
+
+static void videoWorker(MandelVideoQueue * q, int worker)
+{
+	std::unique_lock<std::mutex> lock(q->mutex);
+	int num_buffers = static_cast<int>(q->buffers.size());
+	while(true){
+		while(!q->abort && q->nextFrame < q->numFrames && q->nextFrame >= q->numWritten + num_buffers){
+			q->bufferCondition.wait(lock);
+		}
+		if(q->abort || q->nextFrame >= q->numFrames){
+			break;
+		}
+		int frame = q->nextFrame++;
+		int buffer = frame%num_buffers;
+		lock.unlock();
+		q->func(frame, worker, &q->buffers[buffer][0], q->user);
+		lock.lock();
+		q->done[buffer] = true;
+		q->frameCondition.notify_all();
+	}
+}
+
+int renderMandelVideo(MandelVideoWriter & writer, int num_frames, int num_threads, int num_buffers, MandelFrameFunc func, void * user)
+{
+	if(num_threads < 1)
+		num_threads = 1;
+	if(num_buffers < num_threads)
+		num_buffers = num_threads;
+	MandelVideoQueue q;
+	q.buffers.resize(num_buffers);
+	for(int i = 0; i < num_buffers; i++){
+		q.buffers[i].resize(static_cast<size_t>(writer.getWidth())*writer.getHeight());
+	}
+	q.done.assign(num_buffers, false);
+	q.numFrames = num_frames;
+	q.nextFrame = 0;
+	q.numWritten = 0;
+	q.abort = false;
+	q.func = func;
+	q.user = user;
+	std::vector<std::thread> threads;
+	for(int i = 0; i < num_threads; i++){
+		threads.push_back(std::thread(videoWorker, &q, i));
+	}
+
+	// this thread writes the frames in order
+	std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+	int error = 0;
+	for(int frame = 0; frame < num_frames && !error; frame++){
+		int buffer = frame%num_buffers;
+		{
+			std::unique_lock<std::mutex> lock(q.mutex);
+			while(!q.done[buffer]){
+				q.frameCondition.wait(lock);
+			}
+		}
+		error = writer.writeFrame(&q.buffers[buffer][0]);
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.done[buffer] = false;
+			q.numWritten++;
+			q.abort = error != 0;
+		}
+		q.bufferCondition.notify_all();
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+		printf("\rFrame %d/%d, %.0f s elapsed, about %.0f s left  ", frame+1, num_frames, elapsed, elapsed*(num_frames-frame-1)/(frame+1));
+		fflush(stdout);
+	}
+	printf("\n");
+	for(size_t i = 0; i < threads.size(); i++){
+		threads[i].join();
+	}
+	return error;
+}
@@ -0,0 +1,52 @@
+#ifndef MANDEL_VIDEO_H
+#define MANDEL_VIDEO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+enum MandelVideoFormat{
+	MANDEL_VIDEO_Y4M = 0,// YUV4MPEG2 with 4:4:4 chroma, read by ffmpeg, x264, ...
+	MANDEL_VIDEO_RGB,// raw rgb24 frames, top row first (ffmpeg -f rawvideo -pix_fmt rgb24)
+	NUM_MANDEL_VIDEO_FORMATS
+};
+
+// returns NUM_MANDEL_VIDEO_FORMATS if name is unknown
+MandelVideoFormat getMandelVideoFormat(const char * name);
+
+// Streams frames to a file or to stdout (path "-") for piping into an encoder.
+class MandelVideoWriter{
+public:
+	MandelVideoWriter();
+	~MandelVideoWriter(){close();}
+	// writes the stream header, returns 0 on success. With path "-" the frames go to stdout (see takeStdout).
+	int open(const char * path, int w, int h, int fps, MandelVideoFormat format);
+	// returns a stream to the original stdout, everything printed to stdout from now on goes to stderr
+	// so it does not end up in the video (call it as early as possible)
+	static FILE * takeStdout();
+	int getWidth(){return _w;}
+	int getHeight(){return _h;}
+	// appends a frame of w x h rgba pixels (red in the lowest byte) with the bottom row first,
+	// like MandelCPU::render, returns 0 on success
+	int writeFrame(const uint32_t * rgba);
+	// returns 0 if all frames were written
+	int close();
+private:
+	FILE * _file;
+	int _w;
+	int _h;
+	MandelVideoFormat _format;
+	bool _error;
+	std::vector<uint8_t> _frame;
+};
+
+// called for each frame, worker is in [0, num_threads), rgba holds w x h pixels
+typedef void (*MandelFrameFunc)(int frame, int worker, uint32_t * rgba, void * user);
+
+// Renders num_frames frames with func on num_threads threads, each thread renders whole frames.
+// Frames are written to writer in order, finished frames wait in at most num_buffers buffers
+// for earlier ones (threads stop taking frames when all buffers are in use).
+// Prints progress, returns 0 if all frames were written.
+int renderMandelVideo(MandelVideoWriter & writer, int num_frames, int num_threads, int num_buffers, MandelFrameFunc func, void * user);
+
+#endif
@@ -17,8 +17,11 @@ int Mandelbrot::init(int argc, char * argv[])
 	_juliaC[0] = 0; _juliaC[1] = 0;
 	_zoom = MANDELBROT_INITIAL_ZOOM;
 	_zoomSpeed = 1.1;
-	_position[0] = MANDELBROT_INITIAL_X_OFFSET;
-	_position[1] = 0;
+	_position[0].set(MANDELBROT_INITIAL_X_OFFSET, 2);
+	_position[1].set(0, 2);
+	_hasWindow = false;
+	_screenshotPending = false;
+	_screenshotNumber = 0;
 
 	// check for settings file
 	const char * file_arg_name =  "args.txt";
@@ -48,7 +51,34 @@ int Mandelbrot::init(int argc, char * argv[])
 		return 1;
 	}
 
+	if(_settings.minResolutionScale > _settings.maxResolutionScale){
+		puts("Warning: --min_resolution_scale is above --max_resolution_scale!");
+		_settings.minResolutionScale = _settings.maxResolutionScale;
+	}
 	_settings.print();
+	if(_settings.tileCachePath){
+		if(_tileCache.open(_settings.tileCachePath, static_cast<uint64_t>(_settings.tileCacheSize)<<20)){
+			return 1;
+		}
+		printTileCacheStats();
+		if(_settings.deepZoom || _settings.seriesApproximation){
+			puts("Warning: the tile cache is not used with --deep_zoom or --series_approximation!");
+		}
+	}
+
+	_scheduler.setNumThreads(_settings.threads);
+	_cpu.setColorMap(_settings.colors, _settings.numColors, _settings.nearest);
+	_cpu.setColorOffset(_settings.colorOffset);
+
+	bool cpu_poster = _settings.posterW > 0 && _settings.cpu;
+	if(_settings.headless || _settings.benchmark || cpu_poster || _settings.videoPath ||
+		_settings.escapeDataPath || _settings.recolorPath){// no window needed
+		_windowW = _settings.windowW;
+		_windowH = _settings.windowH;
+		_multisampleEnabled = _settings.multisamples > 0;
+		updateTransform();
+		return 0;
+	}
 
 	// initialize framework
 	if(initWindow()){
@@ -68,9 +98,12 @@ int Mandelbrot::initWindow()
 
 	unsigned int sdl_flags = SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
 	//getting current screen resolution if fullscreen activated
-	_windowW = 800;
-	_windowH = 600;
-	if(_settings.fullscreen){
+	_windowW = _settings.windowW;
+	_windowH = _settings.windowH;
+	if(_settings.posterW > 0){// only the gl context is needed, the poster is drawn offscreen
+		sdl_flags |= SDL_WINDOW_HIDDEN;
+	}
+	else if(_settings.fullscreen){
 		sdl_flags |= SDL_WINDOW_FULLSCREEN;
 		//getting current display-resolution
 		SDL_DisplayMode current;
@@ -90,7 +123,7 @@ int Mandelbrot::initWindow()
 	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
 	SDL_GL_SetAttribute(SDL_GL_BUFFER_SIZE, 32);
-	if(_settings.doublePrecision){// version 4.1 needed for double precision
+	if(_settings.doublePrecision && !_settings.cpu){// version 4.1 needed for double precision
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
 	}
@@ -109,10 +142,19 @@ int Mandelbrot::initWindow()
 
 	//create gl-context
 	SDL_GLContext glContext = SDL_GL_CreateContext(_mainWindow);
+	if(glContext == 0 && _settings.doublePrecision && !_settings.cpu){
+		printf("Warning: Failed to create OpenGL 4.1 context (%s), falling back to emulated double precision.\n", SDL_GetError());
+		_settings.doublePrecision = false;
+		_settings.emulatedDouble = true;
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+		glContext = SDL_GL_CreateContext(_mainWindow);
+	}
 	if (glContext == 0){
 		printf("Error while creating OpenGL Context: %s\n", SDL_GetError());
 		return 1;
 	}
+	_hasWindow = true;
 
 	// activate vsync
 	SDL_GL_SetSwapInterval(1);
@@ -125,7 +167,7 @@ int Mandelbrot::initWindow()
 		return 1;
 	}
 
-	if(_settings.doublePrecision){// if open gl version 4.0 is set create vertex array object
+	if(_settings.doublePrecision && !_settings.cpu){// if open gl version 4.0 is set create vertex array object
 		GLuint vao;
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
@@ -155,8 +197,7 @@ int Mandelbrot::initWindow()
 
 	// generate color map (1d texture)
 	glGenTextures(1, &_colorMap);
-	glBindTexture(GL_TEXTURE_1D, _colorMap);
-	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, _settings.numColors, 0, GL_RGBA, GL_UNSIGNED_BYTE, _settings.colors);
+	updateColorMap();
 	GLint filter = GL_LINEAR;
 	if(_settings.nearest)
 		filter = GL_NEAREST;
@@ -164,13 +205,71 @@ int Mandelbrot::initWindow()
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, filter);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 
+	// frame textures (allocated in resizeWindowEvent())
+	glGenTextures(2, _frameTexture);
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	for(int i = 0; i < 2; i++){
+		glBindTexture(GL_TEXTURE_2D, _frameTexture[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	_frameIndex = 0;
+	_frameIterations[0] = false;
+	_frameIterations[1] = false;
+	_framebuffers = false;
+	if(!_settings.cpu){
+		_framebuffers = GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+		if(_framebuffers){
+			glGenFramebuffers(2, _frameFramebuffer);
+		}
+		else{
+			if(_settings.progressive){
+				puts("Warning: Framebuffer objects not supported, progressive rendering disabled!");
+				_settings.progressive = false;
+			}
+			if(_settings.adaptiveMultisampling){
+				puts("Warning: Framebuffer objects not supported, adaptive multisampling disabled!");
+				_settings.adaptiveMultisampling = false;
+			}
+			if(_settings.gpuTileSize > 0){
+				puts("Warning: Framebuffer objects not supported, tiled rendering disabled!");
+				_settings.gpuTileSize = 0;
+			}
+			if(_settings.dynamicResolution){
+				puts("Warning: Framebuffer objects not supported, dynamic resolution disabled!");
+				_settings.dynamicResolution = false;
+			}
+		}
+	}
+
+	// screenshots are read back asynchronously if pixel buffer objects are supported
+	_pixelBuffers = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+	if(_pixelBuffers){
+		glGenBuffers(1, &_screenshotBuffer);
+	}
+
 	// compiling shader
-	if(_shader.compile(_settings.doublePrecision)){
+	if(_textureShader.compile()){
+		return 1;
+	}
+	MandelShaderPrecision precision = MANDEL_SHADER_FLOAT;
+	if(!_settings.cpu){// shader only used for drawing the cpu frame otherwise
+		if(_settings.doublePrecision)
+			precision = MANDEL_SHADER_DOUBLE;
+		else if(_settings.emulatedDouble)
+			precision = MANDEL_SHADER_DOUBLE_FLOAT;
+	}
+	if(_shader.compile(precision)){
 		return 1;
 	}
 	_shader.use();
 	_shader.setMaxIterations(_settings.maxIterations);
 	_shader.setJulia(_settings.julia);
+	_shader.setInteriorCheck(_settings.interiorCheck);
+	_shader.setColorOffset(_settings.colorOffset);
 	_multisampleEnabled = false;
 	if(_settings.multisamples > 0){
 		if(_settings.multisamples > 16){
@@ -191,26 +290,50 @@ int Mandelbrot::initWindow()
 
 void Mandelbrot::resizeWindowEvent(){
 	glViewport(0, 0, _windowW, _windowH);
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	for(int i = 0; i < 2; i++){
+		glBindTexture(GL_TEXTURE_2D, _frameTexture[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _windowW, _windowH, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		if(_framebuffers){
+			glBindFramebuffer(GL_FRAMEBUFFER, _frameFramebuffer[i]);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _frameTexture[i], 0);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+	_shader.use();
 	_shader.setWindowSize(_windowW, _windowH);
 	updateTransform();
 }
 
 void Mandelbrot::updateTransform(){
-	float scale = _zoom;
-	/*_transform[0];*/	_transform[3] = 0.0;		_transform[6] = _position[0];
-	_transform[1] = 0;	/*_transform[4] = scale;*/ 	_transform[7] = _position[1];
-	_transform[2] = 0;	_transform[5] = 0.0; 		_transform[8] = 1.0;
-	if(_windowW > _windowH){
-		float w_aspect = static_cast<float>(_windowW)/_windowH;
-		_transform[0] = scale*w_aspect;
-		_transform[4] = scale;
+	double pixel_size = 2*_zoom/(_windowW > _windowH ? _windowH : _windowW);
+	// position precision follows the pixel size
+	int limbs = MandelBigFixed::getLimbsForResolution(pixel_size);
+	_position[0].setLimbs(limbs);
+	_position[1].setLimbs(limbs);
+	computeTransform(_zoom, _position[0].toDouble(), _position[1].toDouble(), _windowW, _windowH, _transform);
+	if(_hasWindow){// no shader without gl context
+		_shader.setTransform(_transform);
+		_shader.setPeriodicityTolerance(_settings.periodicityCheck*pixel_size);
+	}
+}
+
+void Mandelbrot::computeTransform(double zoom, double x, double y, int w, int h, double * transform){
+	double scale = zoom;// double, deep zooms go below the float range
+	/*transform[0];*/	transform[3] = 0.0;		transform[6] = x;
+	transform[1] = 0;	/*transform[4] = scale;*/ 	transform[7] = y;
+	transform[2] = 0;	transform[5] = 0.0; 		transform[8] = 1.0;
+	if(w > h){
+		double w_aspect = static_cast<double>(w)/h;
+		transform[0] = scale*w_aspect;
+		transform[4] = scale;
 	}
 	else{
-		float h_aspect = static_cast<float>(_windowH)/_windowW;
-		_transform[0] = scale;
-		_transform[4] = scale*h_aspect;
+		double h_aspect = static_cast<double>(h)/w;
+		transform[0] = scale;
+		transform[4] = scale*h_aspect;
 	}
-	_shader.setTransform(_transform);
 }
 
 void Mandelbrot::printHelp()
@@ -220,13 +343,50 @@ void Mandelbrot::printHelp()
 			"--help                    show this help\n"
 			"--fullscreen              sets window to fullscreen mode\n"
 			"--framerate <fps>         set framerate\n"
+			"--progressive             draw at 1/8, 1/4, 1/2 and full resolution over the following frames after each change\n"
 			"--multisamples <samples>  specify number of samples for multisampling (e.g. 2, 4, 8)\n"
+			"--adaptive_multisampling  multisample only pixels whose neighbours differ in iterations\n"
+			"--gpu_tiles <px>          draw gpu passes in tiles of <px> pixels, spread over frames within the frame budget\n"
+			"--frame_budget <ms>       time per frame for drawing gpu tiles (default: 1000/framerate)\n"
+			"--dynamic_resolution      lower the resolution while the view changes to keep the frame time target\n"
+			"--frame_target <ms>       frame time target of --dynamic_resolution (default: 1000/framerate)\n"
+			"--min_resolution_scale <s> lowest resolution of --dynamic_resolution relative to the window (default 0.25)\n"
+			"--max_resolution_scale <s> highest resolution of --dynamic_resolution relative to the window (default 1)\n"
 			"--max_iterations <value>  number of maximum iterations to determine whether value is in the set\n"
 			"--double_precision        use 64 bit floats instead of 32 bit floats (requires OpenGL version >= 4.1)\n"
+			"--emulated_double         emulate double precision with pairs of 32 bit floats (~48 bit, any OpenGL version)\n"
 			"--colors <file>           specify a .bmp file containing a colormap\n"
+			"--color_offset <x>        shift the color map by x (0..1) for escaped points\n"
 			"--julia                   enables full julia set instead of mandelbrot (start value for z can be selected using the mouse)\n"
 			"--nearest                 use nearest texture filtering for the color map instead of linear\n"
 			"--location <file>         specify a file from which a location on the fractal is loaded\n"
+			"--resolution <w>x<h>      set window resolution (default 800x600)\n"
+			"--headless <file>         render one frame on the cpu and save it as .bmp without opening a window\n"
+			"--poster <w>x<h>          render the view at any size in bands streamed to a .bmp file (gpu offscreen, or cpu with --cpu)\n"
+			"--poster_file <file>      file written by --poster (default poster.bmp)\n"
+			"--video <file>            render a zoom video on the cpu and stream it to <file> (- for stdout)\n"
+			"--video_format <format>   y4m (default) or rgb (raw rgb24 frames)\n"
+			"--video_start <file>      location file of the first frame (default: the current view)\n"
+			"--video_end <file>        location file of the last frame\n"
+			"--video_frames <n>        number of frames (default 300), played at --framerate\n"
+			"--video_exp_map           resample the frames from an exponential map around the end position (faster, no --deep_zoom)\n"
+			"--escape_data <file>      render the view on the cpu and save the iterations before coloring (.mesc)\n"
+			"--recolor <file>          color an escape data file with --colors/--color_offset without computing it\n"
+			"--recolor_file <file>     .bmp written by --recolor (default recolored.bmp)\n"
+			"--tile_cache <dir>        keep iteration counts of cpu renders in a tile pyramid on disk and reuse them (--headless, --cpu)\n"
+			"--tile_cache_size <MB>    size of the tile cache, least recently used tiles are deleted beyond it (default 1024)\n"
+			"--cpu_kernel <kernel>     escape-time kernel used for cpu rendering (auto, scalar, avx2, avx512)\n"
+			"--no_lane_refill          vectorized cpu kernels wait for all lanes instead of loading new pixels into escaped lanes\n"
+			"--no_interior_check       iterate points inside the main cardioid and period-2 bulb instead of skipping them\n"
+			"--periodicity_check <px>  stop iterating when the orbit returns within <px> pixels of an earlier point (e.g. 0.01)\n"
+			"--cpu_strategy <name>     how cpu tiles are computed (brute_force, mariani_silver, boundary_tracing), no multisampling\n"
+			"--cpu                     render on the cpu instead of the gpu\n"
+			"--threads <n>             number of threads used for cpu rendering (default 0: all cores)\n"
+			"--deep_zoom               render on the cpu using perturbation, allows zooming beyond double precision\n"
+			"--series_approximation    like --deep_zoom, skipping the first iterations of all pixels with a series approximation\n"
+			"--series_tolerance <px>   allowed error of the series approximation in pixels (default 0.001)\n"
+			"--benchmark <name>        run a benchmark and quit (bigfixed: multi-limb multiply/square, cpu_strategies: cpu strategies on the current view,\n"
+			"                          adaptive_sampling: adaptive against full multisampling on the current view)\n"
 			"\n"
 			"Controls:\n"
 			"Move the mouse while pressing down the left mouse button to pan.\n"
@@ -235,24 +395,123 @@ void Mandelbrot::printHelp()
 			"When julia set is activated, press the right mouse button to select an offset c in the function f(z) = z^2 + c.\n"
 			"Press <r> to reset everything.\n"
 			"Press <d>/<h> to double/halfen the current max_iterations.\n"
-			"Press <s> to make a screen shot (saved as 'mandelbrot.bmp').\n"
+			"Press <s> to make a screen shot (saved as 'mandelbrot_<n>.bmp' with the next free number).\n"
 			"Press <m> toggle multisampling (only available if option --multisamples set).\n"
+			"Press <c> to shift the color map.\n"
+			"Press <l> to reload the color map file given by --colors.\n"
 	);
 }
 
 void Mandelbrot::run()
 {
+	if(_settings.benchmark){
+		runBenchmark();
+		return;
+	}
+	if(_settings.headless){
+		renderHeadless();
+		return;
+	}
+	if(_settings.posterW > 0){
+		renderPoster();
+		return;
+	}
+	if(_settings.videoPath){
+		renderVideo();
+		return;
+	}
+	if(_settings.escapeDataPath){
+		saveEscapeData();
+		return;
+	}
+	if(_settings.recolorPath){
+		recolor();
+		return;
+	}
 	_redrawEvent = true;
+	_recolorEvent = false;
+	_passScale = 0;
+	_passTile = 0;
+	_dynamicScale = 1/_settings.maxResolutionScale;
+	_frameComplete = false;
+	_frameScale = 1;
+	_frameOffset[0] = 0;
+	_frameOffset[1] = 0;
+	_zoomEvent = false;
+	_panX = 0;
+	_panY = 0;
+	_screenshotEvent = false;
 	while(true){
 		Uint32 t_start = SDL_GetTicks();
+		// pixels read back in the last frame
+		finishScreenshot();
 		if(processEvents()){// rerender only if something changes
 			break;
 		}
-		if(_redrawEvent){
+		bool preview = false;
+		if(_screenshotEvent && _passScale == 0 && !_frameComplete){
+			_redrawEvent = true;// frame was not kept
+		}
+		if(_recolorEvent && (_passScale > 0 || !_frameComplete || !_frameIterations[_frameIndex])){
+			_redrawEvent = true;// colors are part of the frame
+		}
+		if(_redrawEvent){// start over with the first pass
+			_frameComplete = false;
+			startPasses();
+		}
+		else if(_zoomEvent || _panX != 0 || _panY != 0){
+			clearScreen();
+			if(!_zoomEvent && panFrame()){
+				flipScreen();
+			}
+			else{
+				// the last complete frame is shown until the passes are drawn
+				startPasses();
+				if(_frameComplete){
+					drawPreview();
+					flipScreen();
+					preview = true;
+				}
+			}
+		}
+		else if(_recolorEvent){
+			clearScreen();
+			drawImage(_frameTexture[_frameIndex], true, _windowW, _windowH, 0, 0);
+			flipScreen();
+		}
+		_redrawEvent = false;
+		_recolorEvent = false;
+		_zoomEvent = false;
+		_panX = 0;
+		_panY = 0;
+		if(_passScale > 0 && !preview){
+			_frameStart = t_start;
 			clearScreen();
-			render();
+			Uint32 t_render = SDL_GetTicks();
+			bool pass_complete = render();
+			if(_passDynamic){
+				if(!_settings.cpu){// wait for the gpu to measure the render time
+					glFinish();
+				}
+				updateDynamicScale(SDL_GetTicks()-t_render, pass_complete);
+			}
+			if(pass_complete){
+				nextPass();
+				if(_passScale == 0){
+					completeFrame();
+				}
+			}
+			// screenshots show the finished frame
+			if(_screenshotEvent && _passScale == 0){
+				captureScreen();
+			}
 			flipScreen();
-			_redrawEvent = false;
+		}
+		else if(_screenshotEvent && _passScale == 0 && _frameComplete){
+			// drawn again without showing it
+			clearScreen();
+			drawImage(_frameTexture[_frameIndex], _frameIterations[_frameIndex], _windowW, _windowH, 0, 0);
+			captureScreen();
 		}
 		Uint32 t_end = SDL_GetTicks();
 
@@ -263,6 +522,11 @@ void Mandelbrot::run()
 }
 
 void Mandelbrot::quit(){
+	finishScreenshot();
+	if(_tileCache.isOpen()){
+		printTileCacheStats();
+	}
+	_imageWriter.flush();
 	SDL_Quit();
 }
 
@@ -300,17 +564,16 @@ bool Mandelbrot::processEvents(){
 			}
 			else if(keysym == SDLK_s){
 				if(e.key.repeat == 0){
-					saveToFile();
+					_screenshotEvent = true;
 				}
 			}
 			else if(keysym == SDLK_r){
 				if(e.key.repeat == 0){
 					if(_settings.julia)
-						_position[0] = 0;
+						_position[0].set(0, 2);
 					else
-						_position[0] = MANDELBROT_INITIAL_X_OFFSET;
-;
-					_position[1] = 0;
+						_position[0].set(MANDELBROT_INITIAL_X_OFFSET, 2);
+					_position[1].set(0, 2);
 					_zoom = MANDELBROT_INITIAL_ZOOM;
 					updateTransform();
 					_redrawEvent = true;
@@ -338,9 +601,24 @@ bool Mandelbrot::processEvents(){
 					_redrawEvent = true;
 				}
 			}
+			else if(keysym == SDLK_c){// shift color map
+				_settings.colorOffset += MANDELBROT_COLOR_OFFSET_STEP;
+				if(_settings.colorOffset >= 1){
+					_settings.colorOffset -= 1;
+				}
+				_shader.setColorOffset(_settings.colorOffset);
+				_cpu.setColorOffset(_settings.colorOffset);
+				_recolorEvent = true;
+			}
+			else if(keysym == SDLK_l){// reload color map
+				if(e.key.repeat == 0 && _settings.colorsPath != NULL && !loadColors(_settings.colorsPath)){
+					updateColorMap();
+					_recolorEvent = true;
+				}
+			}
 		}break;
 		case SDL_MOUSEWHEEL:{
-			float zoom_before = _zoom;
+			double zoom_before = _zoom;
 			if(e.wheel.y < 0){
 				int max = -e.wheel.y;
 				for(int i = 0; i < max; i++){
@@ -353,19 +631,20 @@ bool Mandelbrot::processEvents(){
 					_zoom /= _zoomSpeed;
 				}
 			}
-			double world_mouse[2];
-			double center[2];
 			double rel_zoom = zoom_before/_zoom;
 			int mouse[2];
-			getWorldMousePos(_windowW/2.0f, _windowH/2.0f, center);
 			SDL_GetMouseState(mouse, mouse+1);
-			getWorldMousePos(mouse[0], mouse[1], world_mouse);
+			// the pixel under the mouse stays in place
+			double m[2] = {static_cast<double>(mouse[0]), static_cast<double>(_windowH-mouse[1])};
+			_frameOffset[0] += m[0]*(1-1/rel_zoom)*_frameScale;
+			_frameOffset[1] += m[1]*(1-1/rel_zoom)*_frameScale;
+			_frameScale /= rel_zoom;
+			_zoomEvent = true;
+			// offset instead of world positions, their difference would cancel out at deep zooms.
+			// The mouse offset shrinks to delta/rel_zoom, so the point under the mouse stays there as in the preview.
 			double delta[2];
-			delta[0] = (center[0]-world_mouse[0]);
-			delta[1] = (center[1]-world_mouse[1]);
-			_position[0] -= delta[0]*rel_zoom -delta[0];
-			_position[1] -= delta[1]*rel_zoom -delta[1];
-			_redrawEvent = true;
+			getMouseOffset(mouse[0], mouse[1], delta);
+			moveView(delta[0]*(1 - 1/rel_zoom), delta[1]*(1 - 1/rel_zoom));
 			updateTransform();
 		}break;
 		case SDL_MOUSEBUTTONDOWN:{
@@ -386,10 +665,14 @@ bool Mandelbrot::processEvents(){
 		}break;
 		case SDL_MOUSEMOTION:{
 			if(_LmousePressed){
-				_position[0] -= 2*_transform[0]*e.motion.xrel/static_cast<double>(_windowW);
-				_position[1] -= -2*_transform[4]*e.motion.yrel/static_cast<double>(_windowH);
+				moveView(-2*_transform[0]*e.motion.xrel/static_cast<double>(_windowW),
+						2*_transform[4]*e.motion.yrel/static_cast<double>(_windowH));
 				updateTransform();
-				_redrawEvent = true;
+				// content moves with the mouse, window y points up
+				_panX += e.motion.xrel;
+				_panY -= e.motion.yrel;
+				_frameOffset[0] -= e.motion.xrel*_frameScale;
+				_frameOffset[1] += e.motion.yrel*_frameScale;
 			}
 			if(_RmousePressed){
 				updateJuliaCFromMousePos(e.motion.x, e.motion.y);
@@ -404,8 +687,22 @@ bool Mandelbrot::processEvents(){
 }
 
 void Mandelbrot::getWorldMousePos(int mouse_x, int mouse_y, double * pos){
-	pos[0] = _transform[0]*(2*mouse_x/static_cast<double>(_windowW) - 1) +  _position[0];
-	pos[1] = _transform[4]*(-2*mouse_y/static_cast<double>(_windowH) + 1) + _position[1];
+	getMouseOffset(mouse_x, mouse_y, pos);
+	pos[0] += _position[0].toDouble();
+	pos[1] += _position[1].toDouble();
+}
+
+void Mandelbrot::getMouseOffset(int mouse_x, int mouse_y, double * offset){
+	offset[0] = _transform[0]*(2*mouse_x/static_cast<double>(_windowW) - 1);
+	offset[1] = _transform[4]*(-2*mouse_y/static_cast<double>(_windowH) + 1);
+}
+
+void Mandelbrot::moveView(double dx, double dy){
+	MandelBigFixed d;
+	d.set(dx, _position[0].getLimbs());
+	MandelBigFixed::add(_position[0], d, _position[0]);
+	d.set(dy, _position[1].getLimbs());
+	MandelBigFixed::add(_position[1], d, _position[1]);
 }
 
 void Mandelbrot::updateJuliaCFromMousePos(int mouse_x, int mouse_y)
@@ -416,12 +713,14 @@ void Mandelbrot::updateJuliaCFromMousePos(int mouse_x, int mouse_y)
 
 int Mandelbrot::parseArguments(int argc, char * argv[])
 {
-	char * color_path = NULL;
 	for(int i = 1; i < argc; i++)
 	{
 		if(!strcmp(argv[i], "--fullscreen")){
 			_settings.fullscreen = true;
 		}
+		else if(!strcmp(argv[i], "--progressive")){
+			_settings.progressive = true;
+		}
 		else if(!strcmp(argv[i], "--framerate")){
 			i++;
 			if(i < argc){
@@ -461,245 +760,1349 @@ int Mandelbrot::parseArguments(int argc, char * argv[])
 				return 1;
 			}
 		}
+		else if(!strcmp(argv[i], "--gpu_tiles")){
+			i++;
+			if(i < argc){
+				_settings.gpuTileSize = atoi(argv[i]);
+				if(_settings.gpuTileSize < 0){
+					_settings.gpuTileSize = 0;
+				}
+			}
+			else{
+				puts("No tile size specified for --gpu_tiles!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--frame_budget")){
+			i++;
+			if(i < argc){
+				_settings.frameBudget = atoi(argv[i]);
+				if(_settings.frameBudget < 0){
+					_settings.frameBudget = 0;
+				}
+			}
+			else{
+				puts("No time specified for --frame_budget!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--dynamic_resolution")){
+			_settings.dynamicResolution = true;
+		}
+		else if(!strcmp(argv[i], "--frame_target")){
+			i++;
+			if(i < argc){
+				_settings.frameTarget = atoi(argv[i]);
+				if(_settings.frameTarget < 0){
+					_settings.frameTarget = 0;
+				}
+			}
+			else{
+				puts("No time specified for --frame_target!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--min_resolution_scale") ||
+				!strcmp(argv[i], "--max_resolution_scale")){
+			const char * option = argv[i];
+			i++;
+			if(i < argc){
+				float scale = static_cast<float>(atof(argv[i]));
+				if(scale <= 0 || scale > 1){
+					printf("Value of %s must be in (0, 1]!\n", option);
+					return 1;
+				}
+				if(!strcmp(option, "--min_resolution_scale"))
+					_settings.minResolutionScale = scale;
+				else
+					_settings.maxResolutionScale = scale;
+			}
+			else{
+				printf("No value specified for %s!\n", option);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--adaptive_multisampling")){
+			_settings.adaptiveMultisampling = true;
+		}
 		else if(!strcmp(argv[i], "--colors")){
 			i++;
 			if(i < argc){
-				color_path = argv[i];
+				_settings.colorsPath = argv[i];
 			}
 			else{
 				puts("No file specified for --colors!");
 				return 1;
 			}
 		}
+		else if(!strcmp(argv[i], "--color_offset")){
+			i++;
+			if(i < argc){
+				_settings.colorOffset = atof(argv[i]);
+				_settings.colorOffset -= floor(_settings.colorOffset);
+			}
+			else{
+				puts("No value specified for --color_offset!");
+				return 1;
+			}
+		}
 		else if(!strcmp(argv[i], "--julia")){
 			_settings.julia = true;	
 		}
+		else if(!strcmp(argv[i], "--emulated_double")){
+			_settings.emulatedDouble = true;
+		}
 		else if(!strcmp(argv[i], "--double_precision")){
 			_settings.doublePrecision = true;	
 		}
 		else if(!strcmp(argv[i], "--nearest")){
 			_settings.nearest = true;	
 		}
-		else if(!strcmp(argv[i], "--location")){
+		else if(!strcmp(argv[i], "--resolution")){
 			i++;
 			if(i < argc){
-				double d1;
-				double d2;
-				char buffer[512];
-				FILE * f = fopen(argv[i], "r");
-				int ret = 0;
-				while(fgets(buffer, 512, f))
-				{
-					int attrib_start = 0;
-					int buffer_len = strlen(buffer);
-					while(isspace(buffer[attrib_start])){attrib_start++;}
-					int attrib_end = attrib_start+1;
-					while(!isspace(buffer[attrib_end])){attrib_end++;}
-					buffer[attrib_end] = '\0';
-					const char * attrib_name = &buffer[attrib_start];
-					const char * values = &buffer[attrib_end];
-					if(buffer_len > attrib_end+1){
-						values = &buffer[attrib_end+1];
-					}
-					if(!strcmp(attrib_name, "position")){
-						if(sscanf(values, "%lf %lf", &_position[0], &_position[1]) == 2){
-							printf("Setting position to (%.20f, %.20f)\n", _position[0], _position[1]);
-						}else{
-							printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
-							break;
-						}
-					}
-					else if(!strcmp(attrib_name, "zoom")){
-						if(sscanf(values, "%lf", &_zoom) == 1){
-							printf("Setting zoom to %.20f\n", _zoom);
-						}else{
-							printf("Error: Expected 1 values for attribute '%s'!\n", attrib_name);
-							break;
-						}
-					}
-					else if(!strcmp(attrib_name, "julia_c")){
-						if(sscanf(values, "%lf %lf", &_juliaC[0], &_juliaC[1]) == 2){
-							printf("Setting full julia set c offset to (%.20f, %.20f)\n", _juliaC[0], _juliaC[1]);
-							_settings.julia = true;
-						}else{
-							printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
-							break;
-						}
-					}
-					else if(!strcmp(attrib_name, "iterations")){
-						if(sscanf(values, "%d", &_settings.maxIterations) == 1){
-							printf("Setting max. iterations to %d\n", _settings.maxIterations);
-						}else{
-							printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
-							break;
-						}
-					}
-					else{
-						printf("Warning: Unknown attribute '%s' encountered while loading location from '%s'!\n", attrib_name, argv[i]);
-					}
+				if(sscanf(argv[i], "%dx%d", &_settings.windowW, &_settings.windowH) != 2 ||
+					_settings.windowW < 1 || _settings.windowH < 1){
+					printf("Invalid resolution '%s', expected <w>x<h>!\n", argv[i]);
+					return 1;
 				}
-				fclose(f);
 			}
 			else{
-				puts("No file specfied for --location");
+				puts("No value specified for --resolution!");
 				return 1;
 			}
 		}
-		else if(!strcmp(argv[i], "--help") ||
-				!strcmp(argv[i], "-h")){
-			printHelp();
-			return 1;	
+		else if(!strcmp(argv[i], "--cpu_kernel")){
+			i++;
+			if(i < argc){
+				_settings.cpuKernel = getMandelKernelType(argv[i]);
+				if(_settings.cpuKernel == NUM_MANDEL_KERNELS){
+					printf("Unknown cpu kernel '%s'!\n", argv[i]);
+					return 1;
+				}
+				if(_settings.cpuKernel != MANDEL_KERNEL_AUTO && !isMandelKernelSupported(_settings.cpuKernel)){
+					printf("Warning: cpu kernel '%s' not supported, falling back to '%s'!\n",
+						argv[i], getMandelKernelName(resolveMandelKernelType(_settings.cpuKernel)));
+				}
+			}
+			else{
+				puts("No kernel specified for --cpu_kernel!");
+				return 1;
+			}
 		}
-		else{
-			printf("Unknown option '%s'!\n", argv[i]);
-			return 1;
+		else if(!strcmp(argv[i], "--no_lane_refill")){
+			_settings.laneRefill = false;
 		}
-	}
-
-	if(color_path != NULL){
-		//open file for reading
-		SDL_Surface * s = SDL_LoadBMP(color_path);
-		if(s == NULL){
-			puts(SDL_GetError());
-			return 1;
+		else if(!strcmp(argv[i], "--no_interior_check")){
+			_settings.interiorCheck = false;
 		}
-		int min = MANDELBROT_MAX_COLORS;
-		if(s->w < min)
-			min = s->w;
-		_settings.numColors = min;
-		switch(s->format->BytesPerPixel){
-			case 1:{
-			for(int i = 0; i < min ; i++){
-				Uint8 value = ((Uint8*)s->pixels)[i];
-				_settings.colors[i] = 0xFF000000 | value<<16 | value<<8 | value;
+		else if(!strcmp(argv[i], "--periodicity_check")){
+			i++;
+			if(i < argc){
+				_settings.periodicityCheck = atof(argv[i]);
+				if(_settings.periodicityCheck < 0){
+					_settings.periodicityCheck = 0;
+				}
 			}
-			}break;
-			case 2:{
-			for(int i = 0; i < min ; i++){
-				_settings.colors[i] = 0xFF000000 | ((Uint16*)s->pixels)[i];
-			}
-			}break;
-			case 3:
-			case 4:{
-				int R_bit_pos = 0, G_bit_pos = 0, B_bit_pos = 0, A_bit_pos;
-			if(s->format->Rmask == 0x000000FF){
-				R_bit_pos = 0;
-				A_bit_pos = 24;
-				if(s->format->Gmask == 0x0000FF00){
-					G_bit_pos = 8;
-					B_bit_pos = 16;
-				}
-				else{
-					printf("Unrecognized color format in '%s'!\n", color_path);
-					SDL_FreeSurface(s);
+			else{
+				puts("No tolerance specified for --periodicity_check!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--cpu_strategy")){
+			i++;
+			if(i < argc){
+				_settings.cpuStrategy = getMandelCPUStrategy(argv[i]);
+				if(_settings.cpuStrategy == NUM_MANDEL_CPU_STRATEGIES){
+					printf("Unknown cpu strategy '%s'!\n", argv[i]);
 					return 1;
 				}
 			}
-			else if(s->format->Rmask == 0xFF000000){
-				R_bit_pos = 24;
-				A_bit_pos = 0;
-				if(s->format->Gmask == 0x00FF0000){
-					G_bit_pos = 16;
-					B_bit_pos = 8;
-				}
-				else{
-					printf("Unrecognized color format in '%s'!\n", color_path);
-					SDL_FreeSurface(s);
+			else{
+				puts("No strategy specified for --cpu_strategy!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--cpu")){
+			_settings.cpu = true;
+		}
+		else if(!strcmp(argv[i], "--deep_zoom")){
+			_settings.deepZoom = true;
+			_settings.cpu = true;
+			_settings.doublePrecision = true;
+		}
+		else if(!strcmp(argv[i], "--series_approximation")){
+			_settings.seriesApproximation = true;
+			_settings.cpu = true;
+			_settings.doublePrecision = true;
+		}
+		else if(!strcmp(argv[i], "--benchmark")){
+			i++;
+			if(i < argc){
+				_settings.benchmark = argv[i];
+			}
+			else{
+				puts("No benchmark specified for --benchmark!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--series_tolerance")){
+			i++;
+			if(i < argc){
+				_settings.seriesTolerance = atof(argv[i]);
+				if(_settings.seriesTolerance <= 0){
+					puts("Series tolerance must be greater than 0!");
 					return 1;
 				}
 			}
-			else if(s->format->Rmask == 0x00FF0000){
-				R_bit_pos = 16;
-				A_bit_pos = 24;
-				if(s->format->Gmask == 0x0000FF00){
-					G_bit_pos = 8;
-					B_bit_pos = 0;
+			else{
+				puts("No value specified for --series_tolerance!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--tile_cache")){
+			i++;
+			if(i < argc){
+				_settings.tileCachePath = argv[i];
+			}
+			else{
+				puts("No directory specified for --tile_cache!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--tile_cache_size")){
+			i++;
+			if(i < argc){
+				_settings.tileCacheSize = atoi(argv[i]);
+				if(_settings.tileCacheSize < 1){
+					_settings.tileCacheSize = 1;
+				}
+			}
+			else{
+				puts("No value specified for --tile_cache_size!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--threads")){
+			i++;
+			if(i < argc){
+				_settings.threads = atoi(argv[i]);
+				if(_settings.threads < 0){
+					_settings.threads = 0;
 				}
-				else{
-					printf("Unrecognized color format in '%s'!\n", color_path);
-					SDL_FreeSurface(s);
+			}
+			else{
+				puts("No value specified for --threads!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--headless")){
+			i++;
+			if(i < argc){
+				_settings.headless = true;
+				_settings.headlessPath = argv[i];
+			}
+			else{
+				puts("No file specified for --headless!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--poster")){
+			i++;
+			if(i < argc){
+				if(sscanf(argv[i], "%dx%d", &_settings.posterW, &_settings.posterH) != 2 ||
+					_settings.posterW < 1 || _settings.posterH < 1){
+					printf("Invalid poster size '%s', expected <w>x<h>!\n", argv[i]);
 					return 1;
 				}
 			}
 			else{
-				printf("Unrecognized color format in '%s'!\n", color_path);
-				SDL_FreeSurface(s);
+				puts("No size specified for --poster!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--poster_file")){
+			i++;
+			if(i < argc){
+				_settings.posterPath = argv[i];
+			}
+			else{
+				puts("No file specified for --poster_file!");
 				return 1;
 			}
-			if(s->format->BytesPerPixel == 3){
-				for(int i = 0; i < min*3; i++){
-					Uint32 r = ((Uint8*)s->pixels)[i*3 + 2];
-					Uint32 g = ((Uint8*)s->pixels)[i*3 + 1]<<8;
-					Uint32 b = ((Uint8*)s->pixels)[i*3 + 0]<<16;
-					_settings.colors[i] = 	r | g | b | 0xFF000000;	
+		}
+		else if(!strcmp(argv[i], "--video")){
+			i++;
+			if(i < argc){
+				_settings.videoPath = argv[i];
+				if(!strcmp(argv[i], "-")){
+					MandelVideoWriter::takeStdout();
 				}
 			}
 			else{
-				for(int i = 0; i < min ; i++){
-					Uint32 color = ((Uint32*)s->pixels)[i];
-					_settings.colors[i] = 	((color&s->format->Rmask)>>R_bit_pos) |
-											(((color&s->format->Gmask)>>G_bit_pos)<<8) |
-											(((color&s->format->Bmask)>>B_bit_pos)<<16) |
-											(((color&s->format->Amask)>>A_bit_pos)<<24);
+				puts("No file specified for --video!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--video_format")){
+			i++;
+			if(i < argc){
+				_settings.videoFormat = getMandelVideoFormat(argv[i]);
+				if(_settings.videoFormat == NUM_MANDEL_VIDEO_FORMATS){
+					printf("Unknown video format '%s'!\n", argv[i]);
+					return 1;
 				}
 			}
-			}break;
+			else{
+				puts("No format specified for --video_format!");
+				return 1;
+			}
 		}
-		SDL_FreeSurface(s);
-	}
-
-	return 0;
-}
-
-void Mandelbrot::render(){
-	GLint vertex_loc = _shader.getVertexLocation();
-	glEnableVertexAttribArray(vertex_loc);
-
-	// drawing rectangle covering the whole screen
-	glBindBuffer(GL_ARRAY_BUFFER, _screenRectBuffer);
-	glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-	/*
-	// visualizing sobol patterns
-	glPointSize(10);
-	int sobol_index = 3;
-	glBindBuffer(GL_ARRAY_BUFFER, _sobolBuffer[sobol_index]);
-	glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glDrawArrays(GL_POINTS, 0, 1<<sobol_index);
-	*/
-}
-
-void Mandelbrot::saveToFile(){
-	const char * path = "mandelbrot.bmp";
-	SDL_Surface *s = SDL_CreateRGBSurface(0, _windowW, _windowH, 32, 0x000000FF,0x0000FF00,0x00FF0000,0xFF000000);
-	glReadPixels(0, 0, _windowW, _windowH, GL_RGBA, GL_UNSIGNED_BYTE, s->pixels);
-	int size = _windowW*_windowH;
-	Uint32 * pixels = ((Uint32*)s->pixels);
-	for(int i =0; i < size/2; i++){
-		int x = i%_windowW;
-		int y = i/_windowW;
-		int mirrored_index = (_windowH-y-1)*_windowW + x;
-		Uint32 p = pixels[mirrored_index];
-		pixels[mirrored_index] = pixels[i];
-		pixels[i] = p;
-	}
-	if(SDL_SaveBMP(s, path)){
-		puts(SDL_GetError());
-	}
-	SDL_FreeSurface(s);
-
-	// saving text file with parameters
-	const char * location_path = "mandelbrot.bmp.txt";
+		else if(!strcmp(argv[i], "--video_start") || !strcmp(argv[i], "--video_end")){
+			const char * option = argv[i];
+			i++;
+			if(i < argc){
+				if(!strcmp(option, "--video_start"))
+					_settings.videoStart = argv[i];
+				else
+					_settings.videoEnd = argv[i];
+			}
+			else{
+				printf("No file specified for %s!\n", option);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--video_exp_map")){
+			_settings.videoExpMap = true;
+		}
+		else if(!strcmp(argv[i], "--video_frames")){
+			i++;
+			if(i < argc){
+				_settings.videoFrames = atoi(argv[i]);
+				if(_settings.videoFrames < 1){
+					puts("Number of video frames must be at least 1!");
+					return 1;
+				}
+			}
+			else{
+				puts("No value specified for --video_frames!");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--escape_data") || !strcmp(argv[i], "--recolor") || !strcmp(argv[i], "--recolor_file")){
+			const char * option = argv[i];
+			i++;
+			if(i < argc){
+				if(!strcmp(option, "--escape_data"))
+					_settings.escapeDataPath = argv[i];
+				else if(!strcmp(option, "--recolor"))
+					_settings.recolorPath = argv[i];
+				else
+					_settings.recolorOutput = argv[i];
+			}
+			else{
+				printf("No file specified for %s!\n", option);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--location")){
+			i++;
+			if(i < argc){
+				if(loadLocation(argv[i])){
+					return 1;
+				}
+			}
+			else{
+				puts("No file specfied for --location");
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "--help") ||
+				!strcmp(argv[i], "-h")){
+			printHelp();
+			return 1;	
+		}
+		else{
+			printf("Unknown option '%s'!\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if(_settings.colorsPath != NULL && loadColors(_settings.colorsPath)){
+		return 1;
+	}
+
+	return 0;
+}
+
+int Mandelbrot::loadColors(const char * path)
+{
+	//open file for reading
+	SDL_Surface * s = SDL_LoadBMP(path);
+	if(s == NULL){
+		puts(SDL_GetError());
+		return 1;
+	}
+	int min = MANDELBROT_MAX_COLORS;
+	if(s->w < min)
+		min = s->w;
+	_settings.numColors = min;
+	switch(s->format->BytesPerPixel){
+		case 1:{
+		for(int i = 0; i < min ; i++){
+			Uint8 value = ((Uint8*)s->pixels)[i];
+			_settings.colors[i] = 0xFF000000 | value<<16 | value<<8 | value;
+		}
+		}break;
+		case 2:{
+		for(int i = 0; i < min ; i++){
+			_settings.colors[i] = 0xFF000000 | ((Uint16*)s->pixels)[i];
+		}
+		}break;
+		case 3:
+		case 4:{
+			int R_bit_pos = 0, G_bit_pos = 0, B_bit_pos = 0, A_bit_pos;
+		if(s->format->Rmask == 0x000000FF){
+			R_bit_pos = 0;
+			A_bit_pos = 24;
+			if(s->format->Gmask == 0x0000FF00){
+				G_bit_pos = 8;
+				B_bit_pos = 16;
+			}
+			else{
+				printf("Unrecognized color format in '%s'!\n", path);
+				SDL_FreeSurface(s);
+				return 1;
+			}
+		}
+		else if(s->format->Rmask == 0xFF000000){
+			R_bit_pos = 24;
+			A_bit_pos = 0;
+			if(s->format->Gmask == 0x00FF0000){
+				G_bit_pos = 16;
+				B_bit_pos = 8;
+			}
+			else{
+				printf("Unrecognized color format in '%s'!\n", path);
+				SDL_FreeSurface(s);
+				return 1;
+			}
+		}
+		else if(s->format->Rmask == 0x00FF0000){
+			R_bit_pos = 16;
+			A_bit_pos = 24;
+			if(s->format->Gmask == 0x0000FF00){
+				G_bit_pos = 8;
+				B_bit_pos = 0;
+			}
+			else{
+				printf("Unrecognized color format in '%s'!\n", path);
+				SDL_FreeSurface(s);
+				return 1;
+			}
+		}
+		else{
+			printf("Unrecognized color format in '%s'!\n", path);
+			SDL_FreeSurface(s);
+			return 1;
+		}
+		if(s->format->BytesPerPixel == 3){
+			for(int i = 0; i < min*3; i++){
+				Uint32 r = ((Uint8*)s->pixels)[i*3 + 2];
+				Uint32 g = ((Uint8*)s->pixels)[i*3 + 1]<<8;
+				Uint32 b = ((Uint8*)s->pixels)[i*3 + 0]<<16;
+				_settings.colors[i] = 	r | g | b | 0xFF000000;	
+			}
+		}
+		else{
+			for(int i = 0; i < min ; i++){
+				Uint32 color = ((Uint32*)s->pixels)[i];
+				_settings.colors[i] = 	((color&s->format->Rmask)>>R_bit_pos) |
+										(((color&s->format->Gmask)>>G_bit_pos)<<8) |
+										(((color&s->format->Bmask)>>B_bit_pos)<<16) |
+										(((color&s->format->Amask)>>A_bit_pos)<<24);
+			}
+		}
+		}break;
+	}
+	SDL_FreeSurface(s);
+	return 0;
+}
+
+void Mandelbrot::updateColorMap()
+{
+	glBindTexture(GL_TEXTURE_1D, _colorMap);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, _settings.numColors, 0, GL_RGBA, GL_UNSIGNED_BYTE, _settings.colors);
+	_cpu.setColorMap(_settings.colors, _settings.numColors, _settings.nearest);
+}
+
+bool Mandelbrot::render(){
+	if(_settings.cpu){
+		renderCPU();
+		return true;
+	}
+	_shader.setNumSamples(_passSamples);
+	// colors of single sample frames are looked up when drawing them, multisampled pixels need the colors of all samples
+	bool iterations = _framebuffers && _passSamples == 1;
+	_shader.setOutputIterations(iterations);
+	if(_passScale > 1){
+		return renderDownscaled();
+	}
+	GLint vertex_loc = _shader.getVertexLocation();
+	if(_passSamples > 1 && _settings.adaptiveMultisampling && _frameIterations[1-_frameIndex]){
+		return renderAdaptive();
+	}
+	if(_framebuffers){// kept for panning and zoom previews
+		int target = 1-_frameIndex;
+		glBindFramebuffer(GL_FRAMEBUFFER, _frameFramebuffer[target]);
+		bool complete = drawTiles(_windowW, _windowH);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		_frameIterations[target] = iterations;
+		if(!complete && _frameComplete){// shown where the pass is not drawn yet
+			drawPreview();
+		}
+		drawPassImage(_frameTexture[target], iterations);
+		return complete;
+	}
+	drawScreenRect(vertex_loc);
+
+	/*
+	// visualizing sobol patterns
+	glPointSize(10);
+	int sobol_index = 3;
+	glBindBuffer(GL_ARRAY_BUFFER, _sobolBuffer[sobol_index]);
+	glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glDrawArrays(GL_POINTS, 0, 1<<sobol_index);
+	*/
+	return true;
+}
+
+bool Mandelbrot::renderDownscaled(){
+	// window_size is scaled down as well, so the view covers the lower left corner of the frame texture
+	int w, h;
+	getPassSize(w, h);
+	int target = 1-_frameIndex;
+	glBindFramebuffer(GL_FRAMEBUFFER, _frameFramebuffer[target]);
+	glViewport(0, 0, w, h);
+	_shader.setWindowSize(_windowW/_passScale, _windowH/_passScale);
+	bool complete = drawTiles(w, h);
+	_shader.setWindowSize(_windowW, _windowH);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, _windowW, _windowH);
+	_frameIterations[target] = true;
+	drawPassImage(_frameTexture[target], true);
+	// the last complete frame is sharper where it still covers the view
+	if(_frameComplete){
+		drawPreview();
+	}
+	return complete;
+}
+
+bool Mandelbrot::renderAdaptive(){
+	// the single sample pass is read while the other frame texture is written, the last complete frame
+	// is not needed anymore since this is the last pass
+	int first_pass = 1-_frameIndex;
+	_frameComplete = false;
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, _frameTexture[first_pass]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, _frameFramebuffer[_frameIndex]);
+	_shader.setAdaptiveSampling(true);
+	bool complete = drawTiles(_windowW, _windowH);
+	_shader.setAdaptiveSampling(false);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	_frameIterations[_frameIndex] = false;
+	if(!complete){// single sample pass where the tiles are not drawn yet
+		drawImage(_frameTexture[first_pass], true, _windowW, _windowH, 0, 0);
+		drawPassImage(_frameTexture[_frameIndex], false);
+		return false;
+	}
+	_frameIndex = first_pass;
+	drawImage(_frameTexture[1-_frameIndex], false, _windowW, _windowH, 0, 0);
+	return true;
+}
+
+bool Mandelbrot::drawTiles(int w, int h){
+	GLint vertex_loc = _shader.getVertexLocation();
+	int tile_size = _settings.gpuTileSize;
+	if(tile_size <= 0){
+		drawScreenRect(vertex_loc);
+		return true;
+	}
+	int tiles_x = (w + tile_size-1)/tile_size;
+	int num_tiles = tiles_x*((h + tile_size-1)/tile_size);
+	Uint32 budget = _settings.frameBudget > 0 ? _settings.frameBudget : 1000/_settings.fps;
+	glEnable(GL_SCISSOR_TEST);
+	while(_passTile < num_tiles){
+		glScissor((_passTile%tiles_x)*tile_size, (_passTile/tiles_x)*tile_size, tile_size, tile_size);
+		drawScreenRect(vertex_loc);
+		// wait for the tile, so no long running draw is queued and the time spent is known
+		glFinish();
+		_passTile++;
+		if(SDL_GetTicks()-_frameStart >= budget || inputPending()){
+			break;
+		}
+	}
+	glDisable(GL_SCISSOR_TEST);
+	return _passTile >= num_tiles;
+}
+
+void Mandelbrot::drawPassImage(GLuint texture, bool iterations){
+	float image_w = _windowW*_passScale;
+	float image_h = _windowH*_passScale;
+	int tile_size = _settings.gpuTileSize;
+	if(tile_size <= 0){
+		drawImage(texture, iterations, image_w, image_h, 0, 0);
+		return;
+	}
+	// the tiles done so far: full rows and the beginning of the next row (in window pixels)
+	int w, h;
+	getPassSize(w, h);
+	int tiles_x = (w + tile_size-1)/tile_size;
+	int rows = _passTile/tiles_x;
+	float size = tile_size*_passScale;
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, _windowW, static_cast<GLsizei>(rows*size));
+	drawImage(texture, iterations, image_w, image_h, 0, 0);
+	glScissor(0, static_cast<GLint>(rows*size), static_cast<GLsizei>((_passTile%tiles_x)*size), static_cast<GLsizei>(size));
+	drawImage(texture, iterations, image_w, image_h, 0, 0);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+bool Mandelbrot::inputPending(){
+	SDL_PumpEvents();
+	if(SDL_HasEvents(SDL_QUIT, SDL_KEYUP) || SDL_HasEvents(SDL_MOUSEBUTTONDOWN, SDL_MOUSEWHEEL)){
+		return true;
+	}
+	// moving the mouse only changes the view while a button is pressed
+	return (_LmousePressed || _RmousePressed) && SDL_HasEvent(SDL_MOUSEMOTION);
+}
+
+bool Mandelbrot::panFrame(){
+	// the cpu renderer cannot compute parts of perturbation frames, cached frames are rendered whole
+	if(!_frameComplete || _passScale > 0 || abs(_panX) >= _windowW || abs(_panY) >= _windowH ||
+		(_settings.cpu && (_settings.deepZoom || _settings.seriesApproximation || useTileCache()))){
+		return false;
+	}
+	if(_settings.cpu){
+		panFrameCPU();
+		return true;
+	}
+	int target = 1-_frameIndex;
+	glBindFramebuffer(GL_FRAMEBUFFER, _frameFramebuffer[target]);
+	// copied as it is, the strips are written in the same form as the frame
+	drawImage(_frameTexture[_frameIndex], false, _windowW, _windowH, _panX, _panY);
+	_frameIterations[target] = _frameIterations[_frameIndex];
+	// exposed strips at the quality of the last pass
+	_shader.setNumSamples(_passSamples);
+	_shader.setOutputIterations(_frameIterations[target]);
+	GLint vertex_loc = _shader.getVertexLocation();
+	glEnable(GL_SCISSOR_TEST);
+	if(_panX != 0){
+		glScissor(_panX > 0 ? 0 : _windowW+_panX, 0, abs(_panX), _windowH);
+		drawScreenRect(vertex_loc);
+	}
+	if(_panY != 0){
+		glScissor(0, _panY > 0 ? 0 : _windowH+_panY, _windowW, abs(_panY));
+		drawScreenRect(vertex_loc);
+	}
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	completeFrame();
+	drawImage(_frameTexture[_frameIndex], _frameIterations[_frameIndex], _windowW, _windowH, 0, 0);
+	return true;
+}
+
+void Mandelbrot::panFrameCPU(){
+	_cpuPanPixels.resize(_windowW*_windowH);
+	for(int y = 0; y < _windowH; y++){
+		int old_y = y-_panY;
+		if(old_y < 0 || old_y >= _windowH)
+			continue;
+		for(int x = 0; x < _windowW; x++){
+			int old_x = x-_panX;
+			if(old_x >= 0 && old_x < _windowW)
+				_cpuPanPixels[y*_windowW + x] = _cpuPixels[old_y*_windowW + old_x];
+		}
+	}
+	_cpuPixels.swap(_cpuPanPixels);
+	updateCPU();
+	_cpu.setNumSamples(_passSamples);
+	if(_panX != 0){
+		int x = _panX > 0 ? 0 : _windowW+_panX;
+		_cpu.renderRect(x, 0, abs(_panX), _windowH, &_cpuPixels[x], _windowW, NULL);
+	}
+	if(_panY != 0){
+		int y = _panY > 0 ? 0 : _windowH+_panY;
+		_cpu.renderRect(0, y, _windowW, abs(_panY), &_cpuPixels[y*_windowW], _windowW, NULL);
+	}
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, _frameTexture[1-_frameIndex]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _windowW, _windowH, 0, GL_RGBA, GL_UNSIGNED_BYTE, &_cpuPixels[0]);
+	glActiveTexture(GL_TEXTURE0);
+	_frameIterations[1-_frameIndex] = false;
+	completeFrame();
+	drawImage(_frameTexture[_frameIndex], false, _windowW, _windowH, 0, 0);
+}
+
+void Mandelbrot::drawPreview(){
+	// texture coordinate of window pixel p: (p*_frameScale + _frameOffset)/window size
+	drawImage(_frameTexture[_frameIndex], _frameIterations[_frameIndex], _windowW/_frameScale, _windowH/_frameScale,
+		-_frameOffset[0]/_frameScale, -_frameOffset[1]/_frameScale);
+}
+
+void Mandelbrot::completeFrame(){
+	// gpu frames can only be kept with framebuffer objects
+	_frameComplete = _settings.cpu || _framebuffers;
+	_frameIndex = 1-_frameIndex;
+	_frameScale = 1;
+	_frameOffset[0] = 0;
+	_frameOffset[1] = 0;
+}
+
+void Mandelbrot::startPasses(){
+	_passScale = 1;
+	if(_settings.dynamicResolution)
+		_passScale = _dynamicScale;
+	else if(_settings.progressive)
+		_passScale = MANDELBROT_PROGRESSIVE_START_SCALE;
+	_passDynamic = _settings.dynamicResolution;
+	_passSamples = 1;
+	_passTile = 0;
+	// adaptive multisampling on the gpu needs the iterations of a single sample pass,
+	// with dynamic resolution multisampling waits until the view stops changing
+	bool first_pass = (_settings.adaptiveMultisampling && !_settings.cpu) || _settings.dynamicResolution;
+	if(_passScale == 1 && _multisampleEnabled && !first_pass){
+		_passSamples = _settings.multisamples;
+	}
+}
+
+void Mandelbrot::nextPass(){
+	_passTile = 0;
+	_passDynamic = false;
+	if(_passScale > 1){
+		_passScale /= 2;
+		if(_passScale < 1)
+			_passScale = 1;
+	}
+	else if(_passSamples == 1 && _multisampleEnabled && _settings.multisamples > 1){
+		_passSamples = _settings.multisamples;
+	}
+	else{
+		_passScale = 0;
+	}
+}
+
+void Mandelbrot::getPassSize(int & w, int & h){
+	w = static_cast<int>(ceilf(_windowW/_passScale));
+	h = static_cast<int>(ceilf(_windowH/_passScale));
+}
+
+void Mandelbrot::updateDynamicScale(Uint32 ms, bool pass_complete){
+	float target = _settings.frameTarget > 0 ? _settings.frameTarget : 1000.f/_settings.fps;
+	// render time is about proportional to the number of pixels, tiled passes that did not finish took too long
+	float factor = pass_complete ? sqrtf((ms > 0 ? ms : 1)/target) : 2;
+	if(factor < 0.5f)
+		factor = 0.5f;
+	if(factor > 2)
+		factor = 2;
+	_dynamicScale *= factor;
+	if(_dynamicScale < 1/_settings.maxResolutionScale)
+		_dynamicScale = 1/_settings.maxResolutionScale;
+	if(_dynamicScale > 1/_settings.minResolutionScale)
+		_dynamicScale = 1/_settings.minResolutionScale;
+}
+
+void Mandelbrot::drawImage(GLuint texture, bool iterations, float image_w, float image_h, float offset_x, float offset_y){
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glActiveTexture(GL_TEXTURE0);
+	_textureShader.use();
+	_textureShader.setImageSize(image_w, image_h);
+	_textureShader.setImageOffset(offset_x, offset_y);
+	_textureShader.setIterations(iterations);
+	if(iterations){
+		_textureShader.setMaxIterations(_settings.maxIterations);
+		_textureShader.setColorOffset(_settings.colorOffset);
+	}
+	drawScreenRect(_textureShader.getVertexLocation());
+	// uniform updates go to the fractal shader
+	_shader.use();
+}
+
+void Mandelbrot::drawScreenRect(GLint vertex_loc){
+	glEnableVertexAttribArray(vertex_loc);
+
+	// drawing rectangle covering the whole screen
+	glBindBuffer(GL_ARRAY_BUFFER, _screenRectBuffer);
+	glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void Mandelbrot::updateCPU(){
+	_cpu.setWindowSize(_windowW, _windowH);
+	_cpu.setTransform(_transform);
+	_cpu.setCenter(_position[0], _position[1]);
+	_cpu.setMaxIterations(_settings.maxIterations);
+	_cpu.setJulia(_settings.julia);
+	_cpu.setJuliaC(_juliaC);
+	_cpu.setDoublePrecision(_settings.doublePrecision || _settings.emulatedDouble);
+	_cpu.setKernel(_settings.cpuKernel);
+	_cpu.setLaneRefill(_settings.laneRefill);
+	_cpu.setInteriorCheck(_settings.interiorCheck);
+	_cpu.setPeriodicityCheck(_settings.periodicityCheck);
+	_cpu.setStrategy(_settings.cpuStrategy);
+	_cpu.setPerturbation(_settings.deepZoom);
+	_cpu.setSeriesApproximation(_settings.seriesApproximation);
+	_cpu.setSeriesTolerance(_settings.seriesTolerance);
+	_cpu.setNumSamples(_multisampleEnabled ? _settings.multisamples : 1);
+	_cpu.setAdaptiveSampling(_settings.adaptiveMultisampling);
+}
+
+void Mandelbrot::renderCPU(){
+	updateCPU();
+	// downscaled passes render a smaller window covering the same view, stretched over the whole window
+	int w, h;
+	getPassSize(w, h);
+	_cpu.setWindowSize(w, h);
+	_cpu.setNumSamples(_passSamples);
+	_cpuPixels.resize(w*h);
+	if(useTileCache())
+		_cpu.renderCached(&_cpuPixels[0], _tileCache, &_scheduler);
+	else
+		_cpu.render(&_cpuPixels[0], &_scheduler);
+
+	int target = 1-_frameIndex;
+	glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, _frameTexture[target]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &_cpuPixels[0]);
+	glActiveTexture(GL_TEXTURE0);
+	_frameIterations[target] = false;
+	drawImage(_frameTexture[target], false, _windowW, _windowH, 0, 0);
+	if(_passScale > 1 && _frameComplete){
+		drawPreview();
+	}
+}
+
+void Mandelbrot::captureScreen(){
+	_screenshotEvent = false;
+	finishScreenshot();// one readback at a time
+	// next free file name, screenshots are never overwritten
+	while(true){
+		_screenshotNumber++;
+		snprintf(_screenshotPath, sizeof(_screenshotPath), "mandelbrot_%04d.bmp", _screenshotNumber);
+		FILE * f = fopen(_screenshotPath, "rb");
+		if(f == NULL)
+			break;
+		fclose(f);
+	}
+	formatLocation(_screenshotLocation, sizeof(_screenshotLocation));
+	_screenshotW = _windowW;
+	_screenshotH = _windowH;
+	if(_pixelBuffers){
+		// the copy runs on the gpu, the pixels are fetched in the next frame
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _screenshotBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, _windowW*_windowH*4, NULL, GL_STREAM_READ);
+		glReadPixels(0, 0, _windowW, _windowH, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		_screenshotPending = true;
+	}
+	else{
+		std::vector<Uint32> pixels(_windowW*_windowH);
+		glReadPixels(0, 0, _windowW, _windowH, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+		writeScreenshot(pixels);
+	}
+}
+
+void Mandelbrot::finishScreenshot(){
+	if(!_screenshotPending)
+		return;
+	_screenshotPending = false;
+	std::vector<Uint32> pixels(_screenshotW*_screenshotH);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _screenshotBuffer);
+	const void * mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if(mapped != NULL){
+		// rows stay bottom-up, which is the row order of .bmp files
+		memcpy(&pixels[0], mapped, pixels.size()*sizeof(Uint32));
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if(mapped == NULL){
+		puts("Failed to read screenshot!");
+		return;
+	}
+	writeScreenshot(pixels);
+}
+
+void Mandelbrot::writeScreenshot(std::vector<Uint32> & pixels){
+	char location_path[sizeof(_screenshotPath) + 4];
+	snprintf(location_path, sizeof(location_path), "%s.txt", _screenshotPath);
+	_imageWriter.write(_screenshotPath, pixels, _screenshotW, _screenshotH, location_path, _screenshotLocation);
+}
+
+void Mandelbrot::formatLocation(char * buffer, int size){
+	char x[MANDELBROT_MAX_COORDINATE_LENGTH];
+	char y[MANDELBROT_MAX_COORDINATE_LENGTH];
+	_position[0].toString(x, sizeof(x));
+	_position[1].toString(y, sizeof(y));
+	int n = snprintf(buffer, size, "position %s %s\nzoom %.20g\niterations %d", x, y, _zoom, _settings.maxIterations);
+	if(_settings.julia && n >= 0 && n < size){
+		snprintf(buffer + n, size - n, "\njulia_c %.20f %.20f", _juliaC[0], _juliaC[1]);
+	}
+}
+
+int Mandelbrot::loadLocation(const char * path){
+	char buffer[MANDELBROT_MAX_LOCATION_LENGTH];
+	FILE * f = fopen(path, "r");
+	if(f == NULL){
+		printf("Failed to open location file '%s'!\n", path);
+		return 1;
+	}
+	while(fgets(buffer, sizeof(buffer), f))
+	{
+		int attrib_start = 0;
+		int buffer_len = strlen(buffer);
+		while(isspace(buffer[attrib_start])){attrib_start++;}
+		int attrib_end = attrib_start+1;
+		while(!isspace(buffer[attrib_end])){attrib_end++;}
+		buffer[attrib_end] = '\0';
+		const char * attrib_name = &buffer[attrib_start];
+		const char * values = &buffer[attrib_end];
+		if(buffer_len > attrib_end+1){
+			values = &buffer[attrib_end+1];
+		}
+		if(!strcmp(attrib_name, "position")){
+			// parsed as MandelBigFixed, doubles would lose the digits of deep zooms
+			const char * y_str;
+			if(_position[0].parse(values, &y_str) && _position[1].parse(y_str)){
+				char x[MANDELBROT_MAX_COORDINATE_LENGTH];
+				char y[MANDELBROT_MAX_COORDINATE_LENGTH];
+				_position[0].toString(x, sizeof(x));
+				_position[1].toString(y, sizeof(y));
+				printf("Setting position to (%s, %s)\n", x, y);
+			}else{
+				printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
+				break;
+			}
+		}
+		else if(!strcmp(attrib_name, "zoom")){
+			if(sscanf(values, "%lf", &_zoom) == 1){
+				printf("Setting zoom to %.20g\n", _zoom);
+			}else{
+				printf("Error: Expected 1 values for attribute '%s'!\n", attrib_name);
+				break;
+			}
+		}
+		else if(!strcmp(attrib_name, "julia_c")){
+			if(sscanf(values, "%lf %lf", &_juliaC[0], &_juliaC[1]) == 2){
+				printf("Setting full julia set c offset to (%.20f, %.20f)\n", _juliaC[0], _juliaC[1]);
+				_settings.julia = true;
+			}else{
+				printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
+				break;
+			}
+		}
+		else if(!strcmp(attrib_name, "iterations")){
+			if(sscanf(values, "%d", &_settings.maxIterations) == 1){
+				printf("Setting max. iterations to %d\n", _settings.maxIterations);
+			}else{
+				printf("Error: Expected 2 values for attribute '%s'!\n", attrib_name);
+				break;
+			}
+		}
+		else{
+			printf("Warning: Unknown attribute '%s' encountered while loading location from '%s'!\n", attrib_name, path);
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+void Mandelbrot::saveLocation(const char * location_path){
 	FILE * f = fopen(location_path, "w");
 	if(f == NULL){
 		printf("Failed to save location file '%s'!", location_path);
 	}
 	else{
-		fprintf(f, "position %.20f %.20f\nzoom %.20f\niterations %d", _position[0], _position[1], _zoom, _settings.maxIterations);
-		if(_settings.julia){
-			fprintf(f, "\njulia_c %.20f %.20f", _juliaC[0], _juliaC[1]);
+		char location[MANDELBROT_MAX_LOCATION_LENGTH];
+		formatLocation(location, sizeof(location));
+		fputs(location, f);
+		fclose(f);
+	}
+}
+
+int Mandelbrot::runBenchmark(){
+	if(!strcmp(_settings.benchmark, "bigfixed")){
+		benchmarkBigFixed();
+	}
+	else if(!strcmp(_settings.benchmark, "cpu_strategies")){
+		updateCPU();
+		benchmarkCPUStrategies(_cpu, _windowW, _windowH, &_scheduler);
+	}
+	else if(!strcmp(_settings.benchmark, "adaptive_sampling")){
+		updateCPU();
+		benchmarkAdaptiveSampling(_cpu, _windowW, _windowH, _settings.multisamples > 1 ? _settings.multisamples : 16, &_scheduler);
+	}
+	else{
+		printf("Unknown benchmark '%s'!\n", _settings.benchmark);
+		return 1;
+	}
+	return 0;
+}
+
+int Mandelbrot::renderHeadless(){
+	updateCPU();
+
+	Uint32 * pixels = new Uint32[_windowW*_windowH];
+	Uint32 t_start = SDL_GetTicks();
+	if(useTileCache())
+		_cpu.renderCached(pixels, _tileCache, &_scheduler);
+	else
+		_cpu.render(pixels, &_scheduler);
+	Uint32 t_end = SDL_GetTicks();
+	printf("Rendered %dx%d pixels in %u ms on %d threads.\n", _windowW, _windowH, t_end-t_start, _scheduler.getNumThreads());
+	if(_settings.deepZoom || _settings.seriesApproximation){
+		printf("Perturbation: %llu reference orbits, %llu glitched points\n",
+			static_cast<unsigned long long>(_cpu.getStats().referenceOrbits),
+			static_cast<unsigned long long>(_cpu.getStats().glitchedPoints));
+		if(_settings.seriesApproximation){
+			printf("Series approximation skipped %d iterations.\n", _cpu.getSeriesSkip());
+		}
+	}
+	else{
+		printf("Lane utilisation: %.1f%% (%s kernel)\n", _cpu.getStats().getLaneUtilisation()*100.0, getMandelKernelName(_cpu.getKernel()));
+		if(_settings.interiorCheck && !_settings.julia){
+			printf("Interior check skipped %llu points.\n", static_cast<unsigned long long>(_cpu.getStats().interiorPoints));
+		}
+		if(_settings.periodicityCheck > 0){
+			printf("Periodicity check stopped %llu points.\n", static_cast<unsigned long long>(_cpu.getStats().periodicPoints));
+		}
+		if(_settings.cpuStrategy != MANDEL_CPU_BRUTE_FORCE){
+			const char * name = getMandelCPUStrategyName(_settings.cpuStrategy);
+			if(_multisampleEnabled && _settings.multisamples > 1)
+				printf("Strategy %s is disabled with multisampling.\n", name);
+			else
+				printf("Strategy %s iterated %.1f%% of the pixels.\n", name, _cpu.getStats().getIteratedFraction()*100.0);
+		}
+		if(_settings.adaptiveMultisampling && _multisampleEnabled && _settings.multisamples > 1){
+			printf("Adaptive multisampling sampled %.1f%% of the pixels again.\n",
+				_cpu.getStats().supersampledPoints*100.0/(_windowW*_windowH));
 		}
+	}
+
+	int error = saveMandelBMP(_settings.headlessPath, pixels, _windowW, _windowH);
+	delete[] pixels;
+	if(!error){
+		printf("Saved image to '%s'.\n", _settings.headlessPath);
+		char location_path[512];
+		snprintf(location_path, sizeof(location_path), "%s.txt", _settings.headlessPath);
+		saveLocation(location_path);
+	}
+	return error;
+}
+
+int Mandelbrot::renderPoster(){
+	if(_settings.deepZoom || _settings.seriesApproximation){
+		puts("--poster does not support --deep_zoom or --series_approximation!");
+		return 1;
+	}
+	bool gpu = !_settings.cpu;
+	if(gpu && !_framebuffers){
+		puts("Framebuffer objects not supported, use --cpu to render the poster!");
+		return 1;
+	}
+	MandelBMPWriter writer;
+	if(writer.open(_settings.posterPath, _settings.posterW, _settings.posterH)){
+		return 1;
+	}
+	// the view covers the poster just like a window of that size
+	_windowW = _settings.posterW;
+	_windowH = _settings.posterH;
+	updateTransform();
+	GLuint texture = 0;
+	GLuint framebuffer = 0;
+	if(gpu){
+		glActiveTexture(GL_TEXTURE0 + MANDEL_IMAGE_TEXTURE_UNIT);
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, MANDELBROT_POSTER_TILE_WIDTH, MANDELBROT_POSTER_BAND_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glActiveTexture(GL_TEXTURE0);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+		glDisable(GL_BLEND);
+		_shader.use();
+	}
+	else{
+		updateCPU();
+	}
+
+	std::vector<Uint32> band(static_cast<size_t>(_windowW)*MANDELBROT_POSTER_BAND_HEIGHT);
+	Uint32 t_start = SDL_GetTicks();
+	int error = 0;
+	// bottom band first, the row order of .bmp files
+	for(int y = 0; y < _windowH && !error; y += MANDELBROT_POSTER_BAND_HEIGHT){
+		int h = _windowH-y < MANDELBROT_POSTER_BAND_HEIGHT ? _windowH-y : MANDELBROT_POSTER_BAND_HEIGHT;
+		if(gpu){
+			renderPosterBandGPU(y, h, &band[0]);
+		}
+		else{
+			_cpu.renderRows(y, h, &band[0], &_scheduler);
+		}
+		error = writer.writeRows(&band[0], h);
+		Uint32 elapsed = SDL_GetTicks()-t_start;
+		double done = static_cast<double>(y+h)/_windowH;
+		printf("\rPoster: %5.1f%% done, %u s elapsed, about %u s left  ", done*100, elapsed/1000,
+			static_cast<unsigned int>(elapsed*(1-done)/done/1000));
+		fflush(stdout);
+	}
+	printf("\n");
+	if(gpu){
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &texture);
+	}
+	if(writer.close() || error){
+		printf("Failed to write poster '%s'!\n", _settings.posterPath);
+		return 1;
+	}
+	printf("Saved %dx%d poster to '%s' in %u s.\n", _windowW, _windowH, _settings.posterPath, (SDL_GetTicks()-t_start)/1000);
+	char location_path[512];
+	snprintf(location_path, sizeof(location_path), "%s.txt", _settings.posterPath);
+	saveLocation(location_path);
+	return 0;
+}
+
+void Mandelbrot::renderPosterBandGPU(int y, int h, Uint32 * rgba){
+	GLint vertex_loc = _shader.getVertexLocation();
+	// tiles are read straight into their columns of the band
+	glPixelStorei(GL_PACK_ROW_LENGTH, _windowW);
+	for(int x = 0; x < _windowW; x += MANDELBROT_POSTER_TILE_WIDTH){
+		int w = _windowW-x < MANDELBROT_POSTER_TILE_WIDTH ? _windowW-x : MANDELBROT_POSTER_TILE_WIDTH;
+		// maps the normalized coordinates of the tile to those of its part of the poster (column major)
+		double tile[9] = {
+			static_cast<double>(w)/_windowW, 0, 0,
+			0, static_cast<double>(h)/_windowH, 0,
+			(2.0*x + w)/_windowW - 1, (2.0*y + h)/_windowH - 1, 1
+		};
+		double transform[9];
+		for(int c = 0; c < 3; c++){
+			for(int r = 0; r < 3; r++){
+				transform[c*3 + r] = _transform[r]*tile[c*3] + _transform[3 + r]*tile[c*3 + 1] + _transform[6 + r]*tile[c*3 + 2];
+			}
+		}
+		_shader.setTransform(transform);
+		_shader.setWindowSize(w, h);
+		glViewport(0, 0, w, h);
+		drawScreenRect(vertex_loc);
+		// waits for the tile, so no long running draws are queued
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba + x);
+	}
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+}
+
+int Mandelbrot::renderVideo(){
+	if(_settings.videoEnd == NULL){
+		puts("No location file for the last frame specified, use --video_end!");
+		return 1;
+	}
+	if(_settings.videoStart != NULL && loadLocation(_settings.videoStart)){
+		return 1;
+	}
+	_videoPosition[0][0] = _position[0];
+	_videoPosition[0][1] = _position[1];
+	_videoZoom[0] = _zoom;
+	_videoIterations[0] = _settings.maxIterations;
+	if(loadLocation(_settings.videoEnd)){
+		return 1;
+	}
+	_videoPosition[1][0] = _position[0];
+	_videoPosition[1][1] = _position[1];
+	_videoZoom[1] = _zoom;
+	_videoIterations[1] = _settings.maxIterations;
+	// all frames are interpolated with the precision of the deepest one
+	double min_zoom = _videoZoom[0] < _videoZoom[1] ? _videoZoom[0] : _videoZoom[1];
+	int limbs = MandelBigFixed::getLimbsForResolution(2*min_zoom/(_windowW > _windowH ? _windowH : _windowW));
+	for(int i = 0; i < 2; i++){
+		for(int j = 0; j < 2; j++){
+			if(_videoPosition[i][j].getLimbs() > limbs)
+				limbs = _videoPosition[i][j].getLimbs();
+		}
+	}
+	for(int i = 0; i < 2; i++){
+		_videoPosition[i][0].setLimbs(limbs);
+		_videoPosition[i][1].setLimbs(limbs);
+	}
+
+	if(_settings.videoExpMap && (_settings.deepZoom || _settings.seriesApproximation)){
+		puts("--video_exp_map does not support --deep_zoom or --series_approximation!");
+		return 1;
+	}
+	if(_videoWriter.open(_settings.videoPath, _windowW, _windowH, _settings.fps, _settings.videoFormat)){
+		return 1;
+	}
+	int error = 0;
+	if(_settings.videoExpMap){
+		error = renderVideoExpMap();
+	}
+	else{
+		// every thread renders whole frames with its own renderer
+		updateCPU();
+		int num_threads = _scheduler.getNumThreads();
+		_videoCPU.assign(num_threads, _cpu);
+		printf("Rendering %d frames of %dx%d pixels on %d threads...\n", _settings.videoFrames, _windowW, _windowH, num_threads);
+		error = renderMandelVideo(_videoWriter, _settings.videoFrames, num_threads, 2*num_threads, renderVideoFrame, this);
+		_videoCPU.clear();
+	}
+	if(_videoWriter.close() || error){
+		printf("Failed to write video '%s'!\n", _settings.videoPath);
+		return 1;
+	}
+	printf("Saved video to '%s'.\n", _settings.videoPath);
+	return 0;
+}
+
+void Mandelbrot::getVideoFrame(int frame, MandelBigFixed * position, double & zoom, int & iterations){
+	double t = _settings.videoFrames > 1 ? static_cast<double>(frame)/(_settings.videoFrames-1) : 0;
+	zoom = _videoZoom[0]*pow(_videoZoom[1]/_videoZoom[0], t);
+	// fraction of the way from start to end position, linear if the zoom does not change
+	double w = t;
+	if(_videoZoom[0] != _videoZoom[1]){
+		w = (_videoZoom[0] - zoom)/(_videoZoom[0] - _videoZoom[1]);
+	}
+	for(int i = 0; i < 2; i++){
+		MandelBigFixed d;
+		MandelBigFixed::sub(_videoPosition[1][i], _videoPosition[0][i], d);
+		MandelBigFixed::mul(d, MandelBigFixed(w, d.getLimbs()), d);
+		MandelBigFixed::add(_videoPosition[0][i], d, position[i]);
+	}
+	iterations = static_cast<int>(_videoIterations[0]*pow(static_cast<double>(_videoIterations[1])/_videoIterations[0], t) + 0.5);
+}
+
+void Mandelbrot::renderVideoFrame(int frame, int worker, uint32_t * rgba, void * user){
+	Mandelbrot * m = static_cast<Mandelbrot*>(user);
+	MandelBigFixed position[2];
+	double zoom;
+	int iterations;
+	m->getVideoFrame(frame, position, zoom, iterations);
+	double transform[9];
+	computeTransform(zoom, position[0].toDouble(), position[1].toDouble(), m->_windowW, m->_windowH, transform);
+	MandelCPU & cpu = m->_videoCPU[worker];
+	cpu.setTransform(transform);
+	cpu.setCenter(position[0], position[1]);
+	cpu.setMaxIterations(iterations);
+	cpu.render(rgba);
+}
+
+int Mandelbrot::renderVideoExpMap(){
+	// all frames share one map, so they are centered at the end position and use the same iterations
+	double center_x = _videoPosition[1][0].toDouble();
+	double center_y = _videoPosition[1][1].toDouble();
+	updateCPU();
+	_cpu.setMaxIterations(_videoIterations[0] > _videoIterations[1] ? _videoIterations[0] : _videoIterations[1]);
+	double zoom_out = _videoZoom[0] > _videoZoom[1] ? _videoZoom[0] : _videoZoom[1];
+	double zoom_in = _videoZoom[0] < _videoZoom[1] ? _videoZoom[0] : _videoZoom[1];
+	double transform[9];
+	// from the corners of the widest frame down to half a pixel of the deepest one
+	computeTransform(zoom_out, center_x, center_y, _windowW, _windowH, transform);
+	double r_top = sqrt(transform[0]*transform[0] + transform[4]*transform[4]);
+	computeTransform(zoom_in, center_x, center_y, _windowW, _windowH, transform);
+	double r_bottom = transform[0]/_windowW < transform[4]/_windowH ? transform[0]/_windowW : transform[4]/_windowH;
+	MandelExpMap map;
+	map.init(center_x, center_y, r_top, r_bottom, _windowW, _windowH);
+	printf("Rendering %d frames of %dx%d pixels from an exponential map of %d angles and %d rows per octave...\n",
+		_settings.videoFrames, _windowW, _windowH, map.getNumAngles(), map.getRowsPerOctave());
+
+	std::vector<Uint32> frame(static_cast<size_t>(_windowW)*_windowH);
+	Uint32 t_start = SDL_GetTicks();
+	for(int i = 0; i < _settings.videoFrames; i++){
+		MandelBigFixed position[2];
+		double zoom;
+		int iterations;
+		getVideoFrame(i, position, zoom, iterations);
+		computeTransform(zoom, center_x, center_y, _windowW, _windowH, transform);
+		_cpu.setTransform(transform);// pixel size for the periodicity check
+		map.prepareFrame(transform, _cpu, &_scheduler);
+		map.renderFrame(transform, &frame[0], &_scheduler);
+		if(_videoWriter.writeFrame(&frame[0])){
+			printf("\n");
+			return 1;
+		}
+		Uint32 elapsed = SDL_GetTicks()-t_start;
+		printf("\rFrame %d/%d, %u s elapsed, about %u s left  ", i+1, _settings.videoFrames, elapsed/1000,
+			static_cast<unsigned int>(static_cast<double>(elapsed)*(_settings.videoFrames-i-1)/(i+1)/1000));
+		fflush(stdout);
+	}
+	printf("\nRendered %d strips of one octave.\n", map.getNumStripsRendered());
+	return 0;
+}
+
+int Mandelbrot::saveEscapeData(){
+	if(_settings.deepZoom || _settings.seriesApproximation){
+		puts("--escape_data does not support --deep_zoom or --series_approximation!");
+		return 1;
+	}
+	updateCPU();
+	std::vector<MandelEscapePixel> pixels(static_cast<size_t>(_windowW)*_windowH);
+	Uint32 t_start = SDL_GetTicks();
+	_cpu.renderEscapeData(&pixels[0], &_scheduler);
+	printf("Rendered escape data of %dx%d pixels in %u ms.\n", _windowW, _windowH, SDL_GetTicks()-t_start);
+
+	MandelEscapeHeader header;
+	initMandelEscapeHeader(header);
+	header.width = _windowW;
+	header.height = _windowH;
+	header.maxIterations = _settings.maxIterations;
+	header.julia = _settings.julia ? 1 : 0;
+	header.zoom = _zoom;
+	header.position[0] = _position[0].toDouble();
+	header.position[1] = _position[1].toDouble();
+	header.juliaC[0] = _juliaC[0];
+	header.juliaC[1] = _juliaC[1];
+	formatLocation(header.location, sizeof(header.location));
+	if(saveMandelEscapeData(_settings.escapeDataPath, header, &pixels[0])){
+		return 1;
+	}
+	printf("Saved escape data to '%s'.\n", _settings.escapeDataPath);
+	return 0;
+}
+
+void Mandelbrot::printTileCacheStats(){
+	printf("Tile cache '%s': %d tiles, %.1f of %.1f MB, %llu hits, %llu misses\n", _settings.tileCachePath,
+		_tileCache.getNumTiles(), _tileCache.getSize()/1048576.0, _tileCache.getMaxSize()/1048576.0,
+		static_cast<unsigned long long>(_tileCache.getHits()), static_cast<unsigned long long>(_tileCache.getMisses()));
+}
+
+int Mandelbrot::recolor(){
+	MandelEscapeFile file;
+	if(file.open(_settings.recolorPath)){
+		return 1;
+	}
+	const MandelEscapeHeader * header = file.getHeader();
+	int w = header->width;
+	int h = header->height;
+	Uint32 t_start = SDL_GetTicks();
+	_cpu.setMaxIterations(header->maxIterations);
+	_cpu.setNumSamples(1);
+	std::vector<Uint32> rgba(static_cast<size_t>(w)*h);
+	_cpu.colorEscapeData(file.getPixels(), w*h, &rgba[0]);
+	printf("Colored %dx%d pixels in %u ms.\n", w, h, SDL_GetTicks()-t_start);
+	if(saveMandelBMP(_settings.recolorOutput, &rgba[0], w, h)){
+		return 1;
+	}
+	printf("Saved image to '%s'.\n", _settings.recolorOutput);
+	char location_path[512];
+	snprintf(location_path, sizeof(location_path), "%s.txt", _settings.recolorOutput);
+	FILE * f = fopen(location_path, "w");
+	if(f == NULL){
+		printf("Failed to save location file '%s'!\n", location_path);
+	}
+	else{
+		// not trusted to be terminated
+		fwrite(header->location, 1, strnlen(header->location, sizeof(header->location)), f);
 		fclose(f);
 	}
+	return 0;
 }
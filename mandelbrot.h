@@ -1,50 +1,172 @@
 #include <SDL2/SDL.h>
 #include "mandel_shader.h"
+#include "mandel_cpu.h"
+#include "mandel_benchmark.h"
+#include "mandel_image_writer.h"
+#include "mandel_video.h"
+#include "mandel_exp_map.h"
 #include <string.h>
 #include <cstring>
 #include <cstdlib>
+#include <math.h>
 #include <ctype.h>
 
 #define MANDELBROT_MAX_COLORS 1024
 #define MANDELBROT_INITIAL_ZOOM 1.2
 #define MANDELBROT_INITIAL_X_OFFSET -0.5
+// downscale factor of the first pass of progressive rendering
+#define MANDELBROT_PROGRESSIVE_START_SCALE 8
+// step of the color map shift with <c>
+#define MANDELBROT_COLOR_OFFSET_STEP 0.0625f
+// buffer size for coordinates written by MandelBigFixed::toString
+#define MANDELBROT_MAX_COORDINATE_LENGTH 640
+// buffer size for the contents of a location file
+#define MANDELBROT_MAX_LOCATION_LENGTH (2*MANDELBROT_MAX_COORDINATE_LENGTH + 256)
+// --poster is rendered in bands of this many rows, only one band is kept in memory
+#define MANDELBROT_POSTER_BAND_HEIGHT 256
+// width of the framebuffer that gpu poster bands are drawn with
+#define MANDELBROT_POSTER_TILE_WIDTH 2048
 struct MandelbrotSettings{
 	MandelbrotSettings(){setToDefault();}
 	void setToDefault(){
 		fullscreen = false;
 		fps = 60;
+		progressive = false;
 		multisamples = 0;
+		adaptiveMultisampling = false;
+		gpuTileSize = 0;
+		dynamicResolution = false;
+		frameTarget = 0;
+		minResolutionScale = 0.25f;
+		maxResolutionScale = 1;
+		frameBudget = 0;
 		maxIterations = 128;
 		julia = false;
 		colors[0] = 0x000000;
 		colors[1] = 0xFFFFFF;
 		numColors = 2;
+		colorsPath = NULL;
+		colorOffset = 0;
 		doublePrecision = false;
+		emulatedDouble = false;
 		nearest = false;
+		windowW = 800;
+		windowH = 600;
+		headless = false;
+		headlessPath = NULL;
+		posterW = 0;
+		posterH = 0;
+		posterPath = "poster.bmp";
+		videoPath = NULL;
+		videoFormat = MANDEL_VIDEO_Y4M;
+		videoStart = NULL;
+		videoEnd = NULL;
+		videoFrames = 300;
+		videoExpMap = false;
+		escapeDataPath = NULL;
+		recolorPath = NULL;
+		recolorOutput = "recolored.bmp";
+		tileCachePath = NULL;
+		tileCacheSize = 1024;
+		cpuKernel = MANDEL_KERNEL_AUTO;
+		laneRefill = true;
+		interiorCheck = true;
+		periodicityCheck = 0;
+		cpuStrategy = MANDEL_CPU_BRUTE_FORCE;
+		cpu = false;
+		threads = 0;
+		deepZoom = false;
+		seriesApproximation = false;
+		seriesTolerance = MANDEL_CPU_SERIES_TOLERANCE;
+		benchmark = NULL;
 	}
 	
 	bool julia;
 	bool doublePrecision;
+	bool emulatedDouble;
 	bool nearest;
 	int maxIterations;
 	Uint32 colors[MANDELBROT_MAX_COLORS];
 	int numColors;
+	const char * colorsPath;// reloaded with <l>
+	float colorOffset;
 	bool fullscreen;
 	int fps;
+	bool progressive;
 	int multisamples;
+	bool adaptiveMultisampling;
+	int gpuTileSize;// 0: passes are drawn at once
+	int frameBudget;// ms, 0: 1000/fps
+	bool dynamicResolution;
+	int frameTarget;// ms, 0: 1000/fps
+	float minResolutionScale;// rendered resolution relative to the window
+	float maxResolutionScale;
+	int windowW;
+	int windowH;
+	bool headless;
+	const char * headlessPath;
+	int posterW;// 0: no poster
+	int posterH;
+	const char * posterPath;
+	const char * videoPath;// NULL: no video, "-": stdout
+	MandelVideoFormat videoFormat;
+	const char * videoStart;// location files, NULL: the view given by --location
+	const char * videoEnd;
+	int videoFrames;
+	bool videoExpMap;// frames are resampled from an exponential map
+	const char * escapeDataPath;// --escape_data output
+	const char * recolorPath;// --recolor input
+	const char * recolorOutput;
+	const char * tileCachePath;// NULL: no tile cache
+	int tileCacheSize;// MB
+	MandelKernelType cpuKernel;
+	bool laneRefill;
+	bool interiorCheck;
+	double periodicityCheck;// tolerance in pixels, 0: off
+	MandelCPUStrategy cpuStrategy;
+	bool cpu;
+	int threads;
+	bool deepZoom;
+	bool seriesApproximation;
+	double seriesTolerance;
+	const char * benchmark;
 
 	void print(){
 		printf(
 			"Settings:\n"
 			"-> fullscreen:      %d\n"
 			"-> fps:             %d\n"
-			"-> multisamples:    %d\n"
+			"-> progressive:     %d\n"
+			"-> gpuTiles:        %d (budget %d ms)\n"
+			"-> dynamicRes.:     %d (target %d ms, scale %g to %g)\n"
+			"-> multisamples:    %d (adaptive %d)\n"
 			"-> maxIterations:   %d\n"
 			"-> doublePrecision: %d\n"
+			"-> emulatedDouble:  %d\n"
 			"-> nearest:         %d\n"
-			"-> numColors:       %d\n",
-			fullscreen, fps, multisamples, maxIterations, doublePrecision,
-			nearest, numColors
+			"-> numColors:       %d\n"
+			"-> colorOffset:     %g\n"
+			"-> resolution:      %dx%d\n"
+			"-> headless:        %d\n"
+			"-> poster:          %dx%d\n"
+			"-> videoFrames:     %d (exp map %d)\n"
+			"-> tileCache:       %s (%d MB)\n"
+			"-> cpuKernel:       %s\n"
+			"-> laneRefill:      %d\n"
+			"-> interiorCheck:   %d\n"
+			"-> periodicity:     %g\n"
+			"-> cpuStrategy:     %s\n"
+			"-> cpu:             %d\n"
+			"-> threads:         %d\n"
+			"-> deepZoom:        %d\n"
+			"-> seriesApprox.:   %d (tolerance %g)\n",
+			fullscreen, fps, progressive, gpuTileSize, frameBudget,
+			dynamicResolution, frameTarget, minResolutionScale, maxResolutionScale, multisamples, adaptiveMultisampling, maxIterations, doublePrecision, emulatedDouble,
+			nearest, numColors, colorOffset, windowW, windowH, headless, posterW, posterH, videoPath ? videoFrames : 0, videoExpMap,
+			tileCachePath ? tileCachePath : "none", tileCacheSize,
+			getMandelKernelName(resolveMandelKernelType(cpuKernel)), laneRefill, interiorCheck, periodicityCheck,
+			getMandelCPUStrategyName(cpuStrategy),
+			cpu, threads, deepZoom, seriesApproximation, seriesTolerance
 		);
 	}
 };
@@ -60,35 +182,163 @@ public:
 	void printHelp();
 private:
 	int parseArguments(int argc, char * argv[]);
+	// reads the color map from a .bmp file into _settings.colors
+	int loadColors(const char * path);
+	// uploads _settings.colors to the color map texture and the cpu renderer
+	void updateColorMap();
 	MandelbrotSettings _settings;
 
-	void saveToFile();
+	// starts reading back the window for a screenshot (after the frame was drawn, before it is shown)
+	void captureScreen();
+	// hands the pixels of a pending screenshot to the image writer
+	void finishScreenshot();
+	void writeScreenshot(std::vector<Uint32> & pixels);
+	// current location in the format read by --location
+	void formatLocation(char * buffer, int size);
+	// sets position, zoom, iterations and julia c from a location file
+	int loadLocation(const char * path);
+	void saveLocation(const char * path);
+	// renders one frame with the cpu renderer and saves it to _settings.headlessPath
+	int renderHeadless();
+	// renders the current view at the --poster size band by band (cpu or offscreen gpu tiles),
+	// every band is written to _settings.posterPath before the next one is rendered
+	int renderPoster();
+	// renders rows [y, y+h) of the poster on the gpu into rgba (_windowW*h pixels), tile by tile
+	void renderPosterBandGPU(int y, int h, Uint32 * rgba);
+	// renders the zoom from --video_start to --video_end on the cpu and streams it to _settings.videoPath
+	int renderVideo();
+	// view of a video frame: zoom and iterations are interpolated exponentially, the position moves
+	// with the zoom so the end position is approached at a constant speed relative to the view
+	void getVideoFrame(int frame, MandelBigFixed * position, double & zoom, int & iterations);
+	static void renderVideoFrame(int frame, int worker, uint32_t * rgba, void * user);
+	// --video_exp_map: renders the exponential map around the end position strip by strip and
+	// resamples the frames from it
+	int renderVideoExpMap();
+	// renders the escape data of the view on the cpu and saves it to _settings.escapeDataPath
+	int saveEscapeData();
+	// colors the escape data file _settings.recolorPath with the current color settings
+	int recolor();
+	// cpu renders go through _tileCache (not with perturbation)
+	bool useTileCache(){return _tileCache.isOpen() && !_settings.deepZoom && !_settings.seriesApproximation;}
+	void printTileCacheStats();
 	int initWindow();
 	void resizeWindowEvent();
 	// returns true if application was quit by user
 	bool processEvents();
 	void updateTransform();
+	// view transform for a window of w x h pixels
+	static void computeTransform(double zoom, double x, double y, int w, int h, double * transform);
 	void updateJuliaCFromMousePos(int, int);
-	void render();
+	// returns false if the pass is not complete yet (tiles left for the next frames)
+	bool render();
+	// renders frame with the cpu renderer and draws it as texture
+	void renderCPU();
+	// passes current state to the cpu renderer
+	void updateCPU();
+	// renders the current pass scaled down into the current frame texture and draws it
+	bool renderDownscaled();
+	// multisamples the pixels of the single sample pass in the current frame texture whose neighbours differ
+	// (--adaptive_multisampling), the result is written to the other frame texture which becomes the current one
+	bool renderAdaptive();
+	// draws the tiles of the current pass starting at _passTile into the bound framebuffer (w x h pixels),
+	// until the frame budget is used up or input is pending, returns true if all tiles are drawn
+	bool drawTiles(int w, int h);
+	// draws the tiles of the current pass done so far from texture
+	void drawPassImage(GLuint texture, bool iterations);
+	// input that changes the view is waiting to be processed
+	bool inputPending();
+	// moves the last complete frame by _panX/_panY pixels and renders only the exposed strips,
+	// returns false if the frame cannot be reused
+	bool panFrame();
+	void panFrameCPU();
+	// draws the last complete frame moved and scaled to the current view
+	void drawPreview();
+	// the frame of the last pass becomes the complete frame
+	void completeFrame();
+	void drawScreenRect(GLint vertex_loc);
+	// draws texture over the window, image_w/image_h is the size of the whole texture in window pixels,
+	// moved by offset_x/offset_y window pixels, iterations colors a texture written by the iteration pass
+	void drawImage(GLuint texture, bool iterations, float image_w, float image_h, float offset_x, float offset_y);
+	// A frame is drawn in passes, one pass per frame: with --progressive at 1/8, 1/4, 1/2 and full
+	// resolution, then with all samples of multisampling. Changing the view starts over.
+	void startPasses();
+	void nextPass();
+	// size of the current pass in pixels
+	void getPassSize(int & w, int & h);
+	// adjusts _dynamicScale to the time of the last dynamic pass
+	void updateDynamicScale(Uint32 ms, bool pass_complete);
 	void clearScreen(){glClear(GL_COLOR_BUFFER_BIT);}
 	void flipScreen(){SDL_GL_SwapWindow(_mainWindow);}
 	void getWorldMousePos(int mouse_x, int mouse_y, double * pos);
+	// offset of the mouse position to the view center in fractal coordinates
+	void getMouseOffset(int mouse_x, int mouse_y, double * offset);
+	// moves _position by an offset in fractal coordinates
+	void moveView(double dx, double dy);
+	// runs the benchmark given by --benchmark
+	int runBenchmark();
 	SDL_Window * _mainWindow;
+	bool _hasWindow;// window and OpenGL context were created (hidden for a gpu poster)
 	int _windowW;
 	int _windowH;
 	bool _redrawEvent;
+	bool _recolorEvent;// only colors changed
+	float _passScale;// downscale factor of the next pass, 0: frame is complete
+	bool _passDynamic;// pass at _dynamicScale after a change, its time adjusts the scale
+	float _dynamicScale;// downscale factor of --dynamic_resolution
+	int _passSamples;// samples per pixel of the next pass
+	int _passTile;// tiles of the current pass drawn so far (--gpu_tiles)
+	Uint32 _frameStart;// ticks at the start of the current frame
+	// _frameTexture[_frameIndex] holds the last complete frame, passes are drawn into the other one
+	// (rendered into by the gpu renderer, uploaded by the cpu renderer).
+	// The gpu renderer cannot keep frames if framebuffer objects are not supported.
+	bool _framebuffers;
+	GLuint _frameFramebuffer[2];
+	GLuint _frameTexture[2];
+	// the frame holds escape iterations instead of colors (gpu frames with one sample per pixel),
+	// so new colors are applied by drawing it again
+	bool _frameIterations[2];
+	int _frameIndex;
+	bool _frameComplete;
+	// window pixel p of the current view is at p*_frameScale + _frameOffset in the complete frame
+	double _frameScale;
+	double _frameOffset[2];
+	bool _zoomEvent;
+	int _panX;// pixels the view was dragged since the last frame (window coordinates)
+	int _panY;
+	std::vector<Uint32> _cpuPanPixels;
+	bool _screenshotEvent;// screenshot of the next finished frame
+	bool _pixelBuffers;// pixel buffer objects supported
+	GLuint _screenshotBuffer;
+	bool _screenshotPending;// _screenshotBuffer is being filled
+	int _screenshotNumber;
+	char _screenshotPath[64];
+	char _screenshotLocation[MANDELBROT_MAX_LOCATION_LENGTH];
+	int _screenshotW;
+	int _screenshotH;
+	MandelImageWriter _imageWriter;
 	GLuint _screenRectBuffer;
 	GLuint _sobolBuffer[NUM_SOBOL_MAPS];
 	MandelShader _shader;
+	MandelCPU _cpu;
+	MandelTileScheduler _scheduler;
+	MandelTileCache _tileCache;
+	TextureShader _textureShader;
+	std::vector<Uint32> _cpuPixels;
 	GLuint _colorMap;
 	double _transform[9];
 	double _zoom;
 	double _zoomSpeed;
 	double _maxZoom;
-	double _position[2];
+	MandelBigFixed _position[2];// limbs are chosen from _zoom in updateTransform()
 	double _juliaC[2];
 	bool _LmousePressed;
 	bool _RmousePressed;
 	bool _multisampleEnabled;
+	// first and last view of --video
+	MandelBigFixed _videoPosition[2][2];
+	double _videoZoom[2];
+	int _videoIterations[2];
+	std::vector<MandelCPU> _videoCPU;// one per thread
+	MandelVideoWriter _videoWriter;
 };
 